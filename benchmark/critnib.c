@@ -0,0 +1,179 @@
+/*
+ *
+ * Copyright (C) 2024 Intel Corporation
+ *
+ * Under the Apache License v2.0 with LLVM Exceptions. See LICENSE.TXT.
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ *
+ */
+
+// Compares lookups in critnib trees with slices of different widths
+// on keys distributed like addresses of regions tracked by the memory tracker.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "critnib.h"
+
+// NOTE: with strict compilation flags, ubench compilation throws some
+// warnings. We disable them here because we do not want to change the ubench
+// code.
+
+// disable warning 6308:'realloc' might return null pointer: assigning null
+// pointer to 'failed_benchmarks', which is passed as an argument to 'realloc',
+// will cause the original memory block to be leaked.
+// disable warning 6001: Using uninitialized memory
+// '*ubench_state.benchmarks.name'.
+#if defined(_MSC_VER)
+#pragma warning(push)
+#pragma warning(disable : 6308)
+#pragma warning(disable : 6001)
+#endif // _MSC_VER
+
+#include "ubench.h"
+
+// BENCHMARK CONFIG
+#define N_KEYS 10000
+#define N_LOOKUPS 100000
+#define REGION_SIZE (64 * 1024)
+
+// user-space addresses are 47 bits wide
+#define ADDRESS_SPACE_MASK ((1ULL << 47) - 1)
+
+static uint64_t Rand_state = 0x2545f4914f6cdd1dULL;
+
+static uint64_t next_rand(void) {
+    // xorshift64
+    Rand_state ^= Rand_state << 13;
+    Rand_state ^= Rand_state >> 7;
+    Rand_state ^= Rand_state << 17;
+    return Rand_state;
+}
+
+typedef struct critnib_bench_s {
+    critnib *c;
+    uintptr_t *keys;
+    uintptr_t *lookups;
+} critnib_bench_t;
+
+// Regions come in clusters of consecutive regions (like slabs allocated by
+// a pool from one mapping) scattered over the address space.
+static critnib_bench_t *critnib_bench_create(unsigned slice) {
+    critnib_bench_t *b = malloc(sizeof(*b));
+    if (b == NULL) {
+        perror("malloc() failed");
+        exit(-1);
+    }
+
+    b->c = critnib_new_with_slice(slice);
+    b->keys = malloc(N_KEYS * sizeof(uintptr_t));
+    b->lookups = malloc(N_LOOKUPS * sizeof(uintptr_t));
+    if (b->c == NULL || b->keys == NULL || b->lookups == NULL) {
+        fprintf(stderr, "failed to create a critnib benchmark\n");
+        exit(-1);
+    }
+
+    Rand_state = 0x2545f4914f6cdd1dULL;
+    uintptr_t base = 0;
+    for (size_t i = 0; i < N_KEYS; i++) {
+        if (i % 16 == 0) {
+            base = (uintptr_t)(next_rand() & ADDRESS_SPACE_MASK &
+                               ~(uintptr_t)(REGION_SIZE - 1));
+        }
+
+        b->keys[i] = base + (i % 16) * REGION_SIZE;
+        // duplicates are very unlikely and harmless for the benchmark
+        (void)critnib_insert(b->c, b->keys[i], &b->keys[i], 0);
+    }
+
+    for (size_t i = 0; i < N_LOOKUPS; i++) {
+        b->lookups[i] =
+            b->keys[next_rand() % N_KEYS] + next_rand() % REGION_SIZE;
+    }
+
+    // the benchmark body runs many times, print the memory usage only once
+    static bool Usage_printed[9];
+    if (!Usage_printed[slice]) {
+        printf("critnib with %u-bit slices: %zu bytes for %d keys\n", slice,
+               critnib_memory_usage(b->c), N_KEYS);
+        Usage_printed[slice] = true;
+    }
+
+    return b;
+}
+
+static void critnib_bench_destroy(critnib_bench_t *b) {
+    critnib_delete(b->c);
+    free(b->keys);
+    free(b->lookups);
+    free(b);
+}
+
+static void do_find_le(critnib_bench_t *b) {
+    uintptr_t rkey;
+    void *rvalue;
+    for (size_t i = 0; i < N_LOOKUPS; i++) {
+        if (!critnib_find(b->c, b->lookups[i], FIND_LE, &rkey, &rvalue)) {
+            fprintf(stderr, "key %p not found\n", (void *)b->lookups[i]);
+            exit(-1);
+        }
+    }
+}
+
+static void do_get(critnib_bench_t *b) {
+    for (size_t i = 0; i < N_LOOKUPS; i++) {
+        uintptr_t key = b->keys[i % N_KEYS];
+        if (critnib_get(b->c, key) == NULL) {
+            fprintf(stderr, "key %p not found\n", (void *)key);
+            exit(-1);
+        }
+    }
+}
+
+UBENCH_EX(find_le, slice_4) {
+    critnib_bench_t *b = critnib_bench_create(4);
+
+    do_find_le(b); // WARMUP
+
+    UBENCH_DO_BENCHMARK() { do_find_le(b); }
+
+    critnib_bench_destroy(b);
+}
+
+UBENCH_EX(find_le, slice_8) {
+    critnib_bench_t *b = critnib_bench_create(8);
+
+    do_find_le(b); // WARMUP
+
+    UBENCH_DO_BENCHMARK() { do_find_le(b); }
+
+    critnib_bench_destroy(b);
+}
+
+UBENCH_EX(get, slice_4) {
+    critnib_bench_t *b = critnib_bench_create(4);
+
+    do_get(b); // WARMUP
+
+    UBENCH_DO_BENCHMARK() { do_get(b); }
+
+    critnib_bench_destroy(b);
+}
+
+UBENCH_EX(get, slice_8) {
+    critnib_bench_t *b = critnib_bench_create(8);
+
+    do_get(b); // WARMUP
+
+    UBENCH_DO_BENCHMARK() { do_get(b); }
+
+    critnib_bench_destroy(b);
+}
+
+UBENCH_MAIN()
+
+#if defined(_MSC_VER)
+#pragma warning(pop)
+#endif // _MSC_VER
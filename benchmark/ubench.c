@@ -138,6 +138,8 @@ static umf_os_memory_provider_params_t UMF_OS_MEMORY_PROVIDER_PARAMS = {
 
     /* .partitions = */ NULL,
     /* .partitions_len = */ 0,
+
+    /* .ipc_map_segments = */ false,
 };
 
 static void *w_umfMemoryProviderAlloc(void *provider, size_t size,
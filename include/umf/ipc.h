@@ -36,6 +36,20 @@ umf_result_t umfPoolGetIPCHandleSize(umf_memory_pool_handle_t hPool,
 umf_result_t umfGetIPCHandle(const void *ptr, umf_ipc_handle_t *ipcHandle,
                              size_t *size);
 
+///
+/// @brief Writes an IPC handle for the specified UMF allocation to a buffer
+///        provided by the caller (e.g. a slot of a ring in shared memory),
+///        without allocating it. The handle has a fixed layout, so it can
+///        be copied as is to another process and passed to umfOpenIPCHandle
+///        there. It must not be released with umfPutIPCHandle.
+/// @param ptr [in] pointer to the allocated memory.
+/// @param buffer [in, out] buffer aligned to 8 bytes.
+/// @param bufferSize [in] size of the buffer in bytes, it has to be at least
+///        the size returned by umfPoolGetIPCHandleSize.
+/// @return UMF_RESULT_SUCCESS on success or appropriate error code on failure.
+umf_result_t umfGetIPCHandleToBuffer(const void *ptr, void *buffer,
+                                     size_t bufferSize);
+
 ///
 /// @brief Release IPC handle retrieved by umfGetIPCHandle.
 /// @param ipcHandle IPC handle.
@@ -57,6 +71,83 @@ umf_result_t umfOpenIPCHandle(umf_memory_pool_handle_t hPool,
 /// @return UMF_RESULT_SUCCESS on success or appropriate error code on failure.
 umf_result_t umfCloseIPCHandle(void *ptr);
 
+///
+/// @brief Creates IPC handles for an array of UMF allocations.
+///        Pointers to the same base allocation should be passed one after
+///        another, their handles are then created with a single lookup.
+///        On failure, no handle is returned.
+/// @param ptrs [in] array of count pointers to the allocated memory.
+/// @param count [in] number of pointers.
+/// @param ipcHandles [out] array of count returned IPC handles, each has to be
+///        released with umfPutIPCHandle.
+/// @param sizes [out] array of count sizes of IPC handles in bytes.
+/// @return UMF_RESULT_SUCCESS on success or appropriate error code on failure.
+umf_result_t umfGetIPCHandles(const void *const *ptrs, size_t count,
+                              umf_ipc_handle_t *ipcHandles, size_t *sizes);
+
+///
+/// @brief Open an array of IPC handles retrieved by umfGetIPCHandle or
+///        umfGetIPCHandles. Handles of the same base allocation share
+///        a single mapping, which is looked up once if they are passed
+///        one after another. On failure, no handle is left open.
+/// @param hPool [in] Pool handle where to open the the IPC handles.
+/// @param ipcHandles [in] array of count IPC handles.
+/// @param count [in] number of IPC handles.
+/// @param ptrs [out] array of count pointers to the memory in the current
+///        process, each has to be closed with umfCloseIPCHandle.
+/// @return UMF_RESULT_SUCCESS on success or appropriate error code on failure.
+umf_result_t umfOpenIPCHandles(umf_memory_pool_handle_t hPool,
+                               const umf_ipc_handle_t *ipcHandles,
+                               size_t count, void **ptrs);
+
+/// @brief Caches of IPC handles kept by a pool
+typedef enum umf_ipc_cache_t {
+    UMF_IPC_CACHE_EXPORTED =
+        0, ///< Handles of memory of the pool returned by umfGetIPCHandle
+    UMF_IPC_CACHE_OPENED =
+        1, ///< Handles opened in the pool by umfOpenIPCHandle
+    /// @cond
+    UMF_IPC_CACHE_FORCE_UINT32 = 0x7fffffff
+    /// @endcond
+} umf_ipc_cache_t;
+
+/// @brief Statistics of a cache of IPC handles
+typedef struct umf_ipc_cache_stats_t {
+    size_t hits;      ///< number of lookups served from the cache
+    size_t misses;    ///< number of lookups which called the memory provider
+    size_t evictions; ///< number of entries evicted to respect the capacity
+    size_t size;      ///< current number of entries of the cache
+} umf_ipc_cache_stats_t;
+
+///
+/// @brief Sets the capacity of a cache of IPC handles of the pool.
+///        Least recently used entries are evicted when the capacity is
+///        exceeded.
+///        UMF_IPC_CACHE_EXPORTED: maximum number of cached handles, at least 1,
+///        unlimited by default. Handles of evicted entries are put back
+///        to the memory provider, so with providers that require it they have
+///        to be opened by consumers before they are evicted.
+///        UMF_IPC_CACHE_OPENED: maximum number of mappings which are not used
+///        anymore, but are kept mapped for the next open of the same handle,
+///        64 by default.
+/// @param hPool [in] Pool handle
+/// @param cache [in] the cache to configure
+/// @param capacity [in] new capacity of the cache
+/// @return UMF_RESULT_SUCCESS on success or appropriate error code on failure.
+umf_result_t umfPoolSetIPCCacheCapacity(umf_memory_pool_handle_t hPool,
+                                        umf_ipc_cache_t cache,
+                                        size_t capacity);
+
+///
+/// @brief Retrieves statistics of a cache of IPC handles of the pool.
+/// @param hPool [in] Pool handle
+/// @param cache [in] the cache to query
+/// @param stats [out] statistics of the cache
+/// @return UMF_RESULT_SUCCESS on success or appropriate error code on failure.
+umf_result_t umfPoolGetIPCCacheStats(umf_memory_pool_handle_t hPool,
+                                     umf_ipc_cache_t cache,
+                                     umf_ipc_cache_stats_t *stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -37,6 +37,14 @@ typedef enum umf_pool_create_flag_t {
          << 0), ///< Pool will own the specified provider and destroy it in umfPoolDestroy
     UMF_POOL_CREATE_FLAG_DISABLE_TRACKING =
         (1 << 1), ///< Pool will not track memory allocations
+    /// Pool will track extents holding many small allocations of the memory
+    /// provider instead of each allocation.
+    /// @warning An IPC handle of an allocation carved from an extent covers
+    ///          the whole extent, so the consumer of the handle gets read and
+    ///          write access to all other allocations of the pool in that
+    ///          extent. Do not use this flag for pools whose memory is shared
+    ///          with processes that must not access all of it.
+    UMF_POOL_CREATE_FLAG_COARSE_TRACKING = (1 << 2),
     /// @cond
     UMF_POOL_CREATE_FLAG_FORCE_UINT32 = 0x7fffffff
     /// @endcond
@@ -48,7 +48,10 @@ typedef struct umf_disjoint_pool_params_t {
     /// Holds size of the pool managed by the allocator.
     size_t CurPoolSize;
 
-    /// Whether to print pool usage statistics
+    /// Whether to print pool usage statistics. Values above 1 print
+    /// statistics of buckets when the pool is destroyed. Values above 2 also
+    /// log every allocation and free with the debug level of the UMF logger,
+    /// if the pool is built with TRACE_POOL_OPERATIONS defined to 1.
     int PoolTrace;
 
     /// Memory limits that can be shared between multitple pool instances,
@@ -58,10 +61,150 @@ typedef struct umf_disjoint_pool_params_t {
 
     /// Name used in traces
     const char *Name;
+
+    /// Maximum number of free chunks cached by each thread for each bucket
+    /// used in chunked mode. Chunks in the per-thread cache are allocated and
+    /// freed without taking the bucket lock. The cache is flushed back to the
+    /// pool when the thread exits or the pool is destroyed.
+    /// Value 0 disables the per-thread cache.
+    size_t ThreadCacheSize;
+
+    /// Set to non-zero if memory returned by the memory provider is known to
+    /// be zero-filled (e.g. fresh anonymous mappings). calloc() then does not
+    /// clear allocations served with memory freshly taken from the provider.
+    int ProviderMemoryZeroed;
+
+    /// Number of independent sets of buckets (shards). Each thread allocates
+    /// from the shard of the NUMA node it is currently running on, which
+    /// keeps slabs and bucket locks local to the node. Memory is always
+    /// freed to the shard it was allocated from.
+    /// Values 0 and 1 disable sharding.
+    size_t NumShards;
+
+    /// Select the shard by the CPU the thread is running on instead of
+    /// its NUMA node.
+    int ShardByCpu;
+
+    /// Custom sizes of buckets (size classes) of 'NumBucketSizes' entries.
+    /// Sizes are rounded up to a multiple of 8 and a bucket for the largest
+    /// poolable size (2GB) is always added. If set, MinBucketSize and
+    /// ClassesPerPowerOf2 are ignored. The array is read only when the pool
+    /// is created.
+    const size_t *BucketSizes;
+    size_t NumBucketSizes;
+
+    /// Number of bucket sizes between two consecutive powers of 2 (including
+    /// the lower one), evenly spaced. This value must be a power of 2.
+    /// Value 0 means 2, i.e. buckets sized such as 64, 96, 128, 192, ...
+    size_t ClassesPerPowerOf2;
+
+    /// Time in milliseconds after which an empty slab kept in the pool is
+    /// purged with umfMemoryProviderPurgeLazy(). The slab stays in the pool.
+    /// Value 0 disables purging.
+    size_t PurgeDelayMs;
+
+    /// Time in milliseconds after which an empty slab kept in the pool is
+    /// returned to the memory provider. Value 0 keeps such slabs until the
+    /// pool is trimmed or destroyed.
+    /// Both delays are checked when memory is returned to the pool.
+    size_t ReleaseDelayMs;
+
+    /// Size of blocks of memory (extents) allocated from the memory provider
+    /// and split into slabs of up to SlabMinSize bytes, so that fewer and
+    /// larger provider allocations are made (and tracked). An extent is
+    /// returned to the provider when all its slabs are freed; one free extent
+    /// is kept until the pool is trimmed. Value 0 or less than twice the
+    /// SlabMinSize allocates every slab directly from the provider.
+    size_t SlabExtentSize;
+
+    /// Maximum total size of freed allocations larger than MaxPoolableSize
+    /// kept for reuse (up to 64 allocations). An allocation is served from
+    /// a cached one at most 1/8 larger than requested. Cached allocations are
+    /// purged and released according to PurgeDelayMs and ReleaseDelayMs, and
+    /// released when the pool is trimmed. They count towards the pool size
+    /// limited by SharedLimits. Value 0 disables the cache.
+    size_t LargeCacheSize;
 } umf_disjoint_pool_params_t;
 
 umf_memory_pool_ops_t *umfDisjointPoolOps(void);
 
+/// @brief Return all empty slabs kept in the pool to the memory provider.
+///        Chunks cached by the calling thread are returned to the pool first.
+/// @param hPool handle to a pool created with umfDisjointPoolOps()
+/// @return UMF_RESULT_SUCCESS on success or appropriate error code on failure.
+umf_result_t umfDisjointPoolTrim(umf_memory_pool_handle_t hPool);
+
+/// @brief Statistics of a single bucket (size class) of Disjoint Pool.
+///        With multiple shards, values of buckets of the same size are summed.
+typedef struct umf_disjoint_pool_bucket_stats_t {
+    /// Size of chunks or slabs of the bucket
+    size_t Size;
+
+    /// Number of allocations served by the bucket
+    size_t AllocCount;
+
+    /// Number of allocations served with memory already kept in the pool
+    size_t AllocPoolCount;
+
+    /// Number of frees of allocations of the bucket
+    size_t FreeCount;
+
+    /// Sum of sizes requested by allocations served by the bucket
+    size_t BytesRequested;
+
+    /// Current and peak number of slabs holding allocations
+    size_t SlabsInUse;
+    size_t MaxSlabsInUse;
+
+    /// Current and peak number of empty slabs kept in the pool
+    size_t SlabsInPool;
+    size_t MaxSlabsInPool;
+} umf_disjoint_pool_bucket_stats_t;
+
+/// @brief Statistics of Disjoint Pool
+typedef struct umf_disjoint_pool_stats_t {
+    /// Number of allocations and frees, including allocations served directly
+    /// by the memory provider
+    size_t AllocCount;
+    size_t FreeCount;
+
+    /// Sum of sizes requested by all allocations
+    size_t BytesRequested;
+
+    /// Sum of sizes of chunks, slabs and provider allocations used to serve
+    /// all allocations. Compared with BytesRequested, it shows how much
+    /// memory is lost to rounding up to bucket sizes.
+    size_t BytesUsed;
+
+    /// Number of calls to allocate and free memory of the memory provider
+    size_t ProviderAllocCount;
+    size_t ProviderFreeCount;
+
+    /// Number of bytes currently allocated from the memory provider
+    size_t ProviderBytes;
+
+    /// Number of bytes of empty slabs and cached large allocations currently
+    /// kept in the pool
+    size_t PoolBytes;
+} umf_disjoint_pool_stats_t;
+
+/// @brief Retrieve statistics of a disjoint pool. Counters are updated without
+///        locking, so the values are not an atomic snapshot of the pool state.
+///        Chunks cached by threads are counted as allocated.
+/// @param hPool handle to a pool created with umfDisjointPoolOps()
+/// @param Stats [out] pool statistics, can be NULL
+/// @param BucketStats [out] array of *NumBuckets entries filled with
+///        statistics of buckets, can be NULL
+/// @param NumBuckets [in,out] size of the BucketStats array on input,
+///        number of buckets of the pool on output; can be NULL only
+///        if BucketStats is NULL
+/// @return UMF_RESULT_SUCCESS on success or appropriate error code on failure.
+umf_result_t
+umfDisjointPoolGetStats(umf_memory_pool_handle_t hPool,
+                        umf_disjoint_pool_stats_t *Stats,
+                        umf_disjoint_pool_bucket_stats_t *BucketStats,
+                        size_t *NumBuckets);
+
 /// @brief Create default params struct for disjoint pool
 static inline umf_disjoint_pool_params_t umfDisjointPoolParamsDefault(void) {
     umf_disjoint_pool_params_t params = {
@@ -72,7 +215,18 @@ static inline umf_disjoint_pool_params_t umfDisjointPoolParamsDefault(void) {
         0,                                         /* CurPoolSize */
         0,                                         /* PoolTrace */
         NULL,                                      /* SharedLimits */
-        "disjoint_pool"                            /* Name */
+        "disjoint_pool",                           /* Name */
+        0,                                         /* ThreadCacheSize */
+        0,                                         /* ProviderMemoryZeroed */
+        0,                                         /* NumShards */
+        0,                                         /* ShardByCpu */
+        NULL,                                      /* BucketSizes */
+        0,                                         /* NumBucketSizes */
+        0,                                         /* ClassesPerPowerOf2 */
+        0,                                         /* PurgeDelayMs */
+        0,                                         /* ReleaseDelayMs */
+        0,                                         /* SlabExtentSize */
+        0                                          /* LargeCacheSize */
     };
 
     return params;
@@ -8,6 +8,8 @@
 #ifndef UMF_OS_MEMORY_PROVIDER_H
 #define UMF_OS_MEMORY_PROVIDER_H
 
+#include <stdbool.h>
+
 #include "umf/memory_provider.h"
 
 #ifdef __cplusplus
@@ -85,6 +87,12 @@ typedef struct umf_os_memory_provider_params_t {
     umf_numa_split_partition_t *partitions;
     /// len of the partitions array
     unsigned partitions_len;
+
+    /// (consumer side) map the whole memory segment (file) of a producer
+    /// once, lazily growing the mapping, and open its IPC handles as
+    /// offsets in this mapping (valid only in case of the shared memory
+    /// visibility)
+    bool ipc_map_segments;
 } umf_os_memory_provider_params_t;
 
 /// @brief OS Memory Provider operation results
@@ -113,7 +121,8 @@ umfOsMemoryProviderParamsDefault(void) {
         UMF_NUMA_MODE_DEFAULT, /* numa_mode */
         0,                     /* part_size */
         NULL,                  /* partitions */
-        0};                    /* partitions_len*/
+        0,                     /* partitions_len*/
+        false};                /* ipc_map_segments */
 
     return params;
 }
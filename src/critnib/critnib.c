@@ -23,7 +23,12 @@
  * Critnib is a hybrid between a radix tree and DJ Bernstein's critbit:
  * it skips nodes for uninteresting radix nodes (ie, ones that would have
  * exactly one child), this requires adding to every node a field that
- * describes the slice (4-bit in our case) that this radix level is for.
+ * describes the slice (4-bit by default) that this radix level is for.
+ *
+ * The width of slices can be chosen when the critnib is created.  Wider
+ * slices make the tree shallower (fewer nodes to walk through on lookups
+ * of sparse keys) at the cost of larger nodes: a node holds 2^slice child
+ * pointers.
  *
  * This implementation also stores each node's path (ie, bits that are
  * common to every key in that subtree) -- this doesn't help with lookups
@@ -84,9 +89,8 @@
  */
 #define DELETED_LIFE 16
 
-#define SLICE 4
-#define NIB ((1ULL << SLICE) - 1)
-#define SLNODES (1 << SLICE)
+#define SLICE_DEFAULT 4
+#define SLICE_MAX 8
 
 typedef uintptr_t word;
 typedef unsigned char sh_t;
@@ -97,7 +101,7 @@ struct critnib_node {
 	 * explicit nodes or collapsed links) -- ie, any subtree below has all
 	 * those bits set to this value.
 	 *
-	 * nib is a 4-bit slice that's an index into the node's children.
+	 * nib is a slice that's an index into the node's children.
 	 *
 	 * shift is the length (in bits) of the part of the key below this node.
 	 *
@@ -107,9 +111,9 @@ struct critnib_node {
 	 *              +-----+
 	 *               shift
 	 */
-    struct critnib_node *child[SLNODES];
     word path;
     sh_t shift;
+    struct critnib_node *child[]; /* 2^slice entries */
 };
 
 struct critnib_leaf {
@@ -120,6 +124,16 @@ struct critnib_leaf {
 struct critnib {
     struct critnib_node *root;
 
+    /* width of slices in bits, mask of a slice and number of children */
+    sh_t slice;
+    word nib;
+    unsigned slnodes;
+    size_t node_size;
+
+    /* number of nodes and leaves allocated from malloc */
+    size_t n_nodes;
+    size_t n_leaves;
+
     /* pool of freed nodes: singly linked list, next at child[0] */
     struct critnib_node *deleted_node;
     struct critnib_leaf *deleted_leaf;
@@ -167,19 +181,34 @@ static inline struct critnib_leaf *to_leaf(struct critnib_node *n) {
  * internal: path_mask -- return bit mask of a path above a subtree [shift]
  * bits tall
  */
-static inline word path_mask(sh_t shift) { return ~NIB << shift; }
+static inline word path_mask(word nib, sh_t shift) { return ~nib << shift; }
 
 /*
  * internal: slice_index -- return index of child at the given nib
  */
-static inline unsigned slice_index(word key, sh_t shift) {
-    return (unsigned)((key >> shift) & NIB);
+static inline unsigned slice_index(word nib, word key, sh_t shift) {
+    return (unsigned)((key >> shift) & nib);
 }
 
 /*
- * critnib_new -- allocates a new critnib structure
+ * critnib_new -- allocates a new critnib structure with the default slice
+ */
+struct critnib *critnib_new(void) { return critnib_new_with_slice(0); }
+
+/*
+ * critnib_new_with_slice -- allocates a new critnib structure with slices
+ * of the given width in bits (a power of 2 not greater than 8, 0 means
+ * the default)
  */
-struct critnib *critnib_new(void) {
+struct critnib *critnib_new_with_slice(unsigned slice) {
+    if (slice == 0) {
+        slice = SLICE_DEFAULT;
+    }
+
+    if (slice > SLICE_MAX || (slice & (slice - 1))) {
+        return NULL;
+    }
+
     struct critnib *c = umf_ba_global_alloc(sizeof(struct critnib));
     if (!c) {
         return NULL;
@@ -187,6 +216,12 @@ struct critnib *critnib_new(void) {
 
     memset(c, 0, sizeof(struct critnib));
 
+    c->slice = (sh_t)slice;
+    c->nib = (1ULL << slice) - 1;
+    c->slnodes = 1U << slice;
+    c->node_size = sizeof(struct critnib_node) +
+                   c->slnodes * sizeof(struct critnib_node *);
+
     void *mutex_ptr = utils_mutex_init(&c->mutex);
     if (!mutex_ptr) {
         goto err_free_critnib;
@@ -208,7 +243,7 @@ static void delete_node(struct critnib *c, struct critnib_node *__restrict n) {
     if (is_leaf(n)) {
         umf_ba_global_free(to_leaf(n));
     } else {
-        for (int i = 0; i < SLNODES; i++) {
+        for (unsigned i = 0; i < c->slnodes; i++) {
             if (n->child[i]) {
                 delete_node(c, n->child[i]);
             }
@@ -272,13 +307,17 @@ static void free_node(struct critnib *__restrict c,
  */
 static struct critnib_node *alloc_node(struct critnib *__restrict c) {
     if (!c->deleted_node) {
-        return umf_ba_global_alloc(sizeof(struct critnib_node));
+        struct critnib_node *n = umf_ba_global_alloc(c->node_size);
+        if (n) {
+            c->n_nodes++;
+        }
+        return n;
     }
 
     struct critnib_node *n = c->deleted_node;
 
     c->deleted_node = n->child[0];
-    VALGRIND_ANNOTATE_NEW_MEMORY(n, sizeof(*n));
+    VALGRIND_ANNOTATE_NEW_MEMORY(n, c->node_size);
 
     return n;
 }
@@ -303,7 +342,12 @@ static void free_leaf(struct critnib *__restrict c,
  */
 static struct critnib_leaf *alloc_leaf(struct critnib *__restrict c) {
     if (!c->deleted_leaf) {
-        return umf_ba_global_alloc(sizeof(struct critnib_leaf));
+        struct critnib_leaf *k =
+            umf_ba_global_alloc(sizeof(struct critnib_leaf));
+        if (k) {
+            c->n_leaves++;
+        }
+        return k;
     }
 
     struct critnib_leaf *k = c->deleted_leaf;
@@ -315,22 +359,12 @@ static struct critnib_leaf *alloc_leaf(struct critnib *__restrict c) {
 }
 
 /*
- * critnib_insert -- write a key:value pair to the critnib structure
- *
- * Returns:
- *  • 0 on success
- *  • EEXIST if such a key already exists
- *  • ENOMEM if we're out of memory
- *
- * Takes a global write lock but doesn't stall any readers.
+ * internal: insert_locked -- critnib_insert() with the write lock held
  */
-int critnib_insert(struct critnib *c, word key, void *value, int update) {
-    utils_mutex_lock(&c->mutex);
-
+static int insert_locked(struct critnib *c, word key, void *value,
+                         int update) {
     struct critnib_leaf *k = alloc_leaf(c);
     if (!k) {
-        utils_mutex_unlock(&c->mutex);
-
         return ENOMEM;
     }
 
@@ -345,25 +379,22 @@ int critnib_insert(struct critnib *c, word key, void *value, int update) {
     if (!n) {
         store(&c->root, kn);
 
-        utils_mutex_unlock(&c->mutex);
-
         return 0;
     }
 
     struct critnib_node **parent = &c->root;
     struct critnib_node *prev = c->root;
+    word nib = c->nib;
 
-    while (n && !is_leaf(n) && (key & path_mask(n->shift)) == n->path) {
+    while (n && !is_leaf(n) && (key & path_mask(nib, n->shift)) == n->path) {
         prev = n;
-        parent = &n->child[slice_index(key, n->shift)];
+        parent = &n->child[slice_index(nib, key, n->shift)];
         n = *parent;
     }
 
     if (!n) {
         n = prev;
-        store(&n->child[slice_index(key, n->shift)], kn);
-
-        utils_mutex_unlock(&c->mutex);
+        store(&n->child[slice_index(nib, key, n->shift)], kn);
 
         return 0;
     }
@@ -377,51 +408,61 @@ int critnib_insert(struct critnib *c, word key, void *value, int update) {
 
         if (update) {
             to_leaf(n)->value = value;
-            utils_mutex_unlock(&c->mutex);
             return 0;
         } else {
-            utils_mutex_unlock(&c->mutex);
             return EEXIST;
         }
     }
 
     /* and convert that to an index. */
-    sh_t sh = utils_mssb_index(at) & (sh_t) ~(SLICE - 1);
+    sh_t sh = utils_mssb_index(at) & (sh_t) ~(c->slice - 1);
 
     struct critnib_node *m = alloc_node(c);
     if (!m) {
         free_leaf(c, to_leaf(kn));
 
-        utils_mutex_unlock(&c->mutex);
-
         return ENOMEM;
     }
-    VALGRIND_HG_DRD_DISABLE_CHECKING(m, sizeof(struct critnib_node));
+    VALGRIND_HG_DRD_DISABLE_CHECKING(m, c->node_size);
 
-    for (int i = 0; i < SLNODES; i++) {
+    for (unsigned i = 0; i < c->slnodes; i++) {
         m->child[i] = NULL;
     }
 
-    m->child[slice_index(key, sh)] = kn;
-    m->child[slice_index(path, sh)] = n;
+    m->child[slice_index(nib, key, sh)] = kn;
+    m->child[slice_index(nib, path, sh)] = n;
     m->shift = sh;
-    m->path = key & path_mask(sh);
+    m->path = key & path_mask(nib, sh);
     store(parent, m);
 
+    return 0;
+}
+
+/*
+ * critnib_insert -- write a key:value pair to the critnib structure
+ *
+ * Returns:
+ *  • 0 on success
+ *  • EEXIST if such a key already exists
+ *  • ENOMEM if we're out of memory
+ *
+ * Takes a global write lock but doesn't stall any readers.
+ */
+int critnib_insert(struct critnib *c, word key, void *value, int update) {
+    utils_mutex_lock(&c->mutex);
+    int ret = insert_locked(c, key, value, update);
     utils_mutex_unlock(&c->mutex);
 
-    return 0;
+    return ret;
 }
 
 /*
- * critnib_remove -- delete a key from the critnib structure, return its value
+ * internal: remove_locked -- critnib_remove() with the write lock held
  */
-void *critnib_remove(struct critnib *c, word key) {
+static void *remove_locked(struct critnib *c, word key) {
     struct critnib_leaf *k;
     void *value = NULL;
 
-    utils_mutex_lock(&c->mutex);
-
     struct critnib_node *n = c->root;
     if (!n) {
         goto not_found;
@@ -453,7 +494,7 @@ void *critnib_remove(struct critnib *c, word key) {
     while (!is_leaf(kn)) {
         n_parent = k_parent;
         n = kn;
-        k_parent = &kn->child[slice_index(key, kn->shift)];
+        k_parent = &kn->child[slice_index(c->nib, key, kn->shift)];
         kn = *k_parent;
 
         if (!kn) {
@@ -466,11 +507,11 @@ void *critnib_remove(struct critnib *c, word key) {
         goto not_found;
     }
 
-    store(&n->child[slice_index(key, n->shift)], NULL);
+    store(&n->child[slice_index(c->nib, key, n->shift)], NULL);
 
     /* Remove the node if there's only one remaining child. */
     int ochild = -1;
-    for (int i = 0; i < SLNODES; i++) {
+    for (int i = 0; i < (int)c->slnodes; i++) {
         if (n->child[i]) {
             if (ochild != -1) {
                 goto del_leaf;
@@ -490,10 +531,48 @@ del_leaf:
     c->pending_del_leaves[del] = k;
 
 not_found:
+    return value;
+}
+
+/*
+ * critnib_remove -- delete a key from the critnib structure, return its value
+ */
+void *critnib_remove(struct critnib *c, word key) {
+    utils_mutex_lock(&c->mutex);
+    void *value = remove_locked(c, key);
     utils_mutex_unlock(&c->mutex);
+
     return value;
 }
 
+/*
+ * critnib_remove_batch -- delete n keys from the critnib structure taking
+ * the write lock only once
+ *
+ * If values is not NULL, values[i] is set to the value of keys[i] or to NULL
+ * if that key was not found.  Returns the number of keys removed.
+ */
+size_t critnib_remove_batch(struct critnib *c, const word *keys,
+                            void **values, size_t n) {
+    size_t n_removed = 0;
+
+    utils_mutex_lock(&c->mutex);
+
+    for (size_t i = 0; i < n; i++) {
+        void *value = remove_locked(c, keys[i]);
+        if (value) {
+            n_removed++;
+        }
+        if (values) {
+            values[i] = value;
+        }
+    }
+
+    utils_mutex_unlock(&c->mutex);
+
+    return n_removed;
+}
+
 /*
  * critnib_get -- query for a key ("==" match), returns value or NULL
  *
@@ -507,6 +586,7 @@ not_found:
 void *critnib_get(struct critnib *c, word key) {
     uint64_t wrs1, wrs2;
     void *res;
+    word nib = c->nib;
 
     do {
         struct critnib_node *n;
@@ -520,7 +600,7 @@ void *critnib_get(struct critnib *c, word key) {
 		 * going wrong way if our path is missing, but that's ok...
 		 */
         while (n && !is_leaf(n)) {
-            load(&n->child[slice_index(key, n->shift)], &n);
+            load(&n->child[slice_index(nib, key, n->shift)], &n);
         }
 
         /* ... as we check it at the end. */
@@ -536,10 +616,10 @@ void *critnib_get(struct critnib *c, word key) {
  * internal: find_predecessor -- return the rightmost leaf in a subtree
  */
 static struct critnib_leaf *
-find_predecessor(struct critnib_node *__restrict n) {
+find_predecessor(struct critnib_node *__restrict n, word nib_mask) {
     while (1) {
         int nib;
-        for (nib = NIB; nib >= 0; nib--) {
+        for (nib = (int)nib_mask; nib >= 0; nib--) {
             if (n->child[nib]) {
                 break;
             }
@@ -560,7 +640,7 @@ find_predecessor(struct critnib_node *__restrict n) {
  * internal: find_le -- recursively search <= in a subtree
  */
 static struct critnib_leaf *find_le(struct critnib_node *__restrict n,
-                                    word key) {
+                                    word key, word nib_mask) {
     if (!n) {
         return NULL;
     }
@@ -577,13 +657,13 @@ static struct critnib_leaf *find_le(struct critnib_node *__restrict n,
 	 * that shift points at the nib's lower rather than upper edge, so it
 	 * needs to be masked away as well.
 	 */
-    if ((key ^ n->path) >> (n->shift) & ~NIB) {
+    if ((key ^ n->path) >> (n->shift) & ~nib_mask) {
         /*
 		 * subtree is too far to the left?
 		 * -> its rightmost value is good
 		 */
         if (n->path < key) {
-            return find_predecessor(n);
+            return find_predecessor(n, nib_mask);
         }
 
         /*
@@ -593,12 +673,12 @@ static struct critnib_leaf *find_le(struct critnib_node *__restrict n,
         return NULL;
     }
 
-    unsigned nib = slice_index(key, n->shift);
+    unsigned nib = slice_index(nib_mask, key, n->shift);
     /* recursive call: follow the path */
     {
         struct critnib_node *m;
         load(&n->child[nib], &m);
-        struct critnib_leaf *k = find_le(m, key);
+        struct critnib_leaf *k = find_le(m, key, nib_mask);
         if (k) {
             return k;
         }
@@ -618,7 +698,7 @@ static struct critnib_leaf *find_le(struct critnib_node *__restrict n,
                 return to_leaf(n);
             }
 
-            return find_predecessor(n);
+            return find_predecessor(n, nib_mask);
         }
     }
 
@@ -638,7 +718,7 @@ void *critnib_find_le(struct critnib *c, word key) {
         load64(&c->remove_count, &wrs1);
         struct critnib_node *n; /* avoid a subtle TOCTOU */
         load(&c->root, &n);
-        struct critnib_leaf *k = n ? find_le(n, key) : NULL;
+        struct critnib_leaf *k = n ? find_le(n, key, c->nib) : NULL;
         res = k ? k->value : NULL;
         load64(&c->remove_count, &wrs2);
     } while (wrs1 + DELETED_LIFE <= wrs2);
@@ -649,16 +729,17 @@ void *critnib_find_le(struct critnib *c, word key) {
 /*
  * internal: find_successor -- return the rightmost leaf in a subtree
  */
-static struct critnib_leaf *find_successor(struct critnib_node *__restrict n) {
+static struct critnib_leaf *find_successor(struct critnib_node *__restrict n,
+                                           word nib_mask) {
     while (1) {
         unsigned nib;
-        for (nib = 0; nib <= NIB; nib++) {
+        for (nib = 0; nib <= nib_mask; nib++) {
             if (n->child[nib]) {
                 break;
             }
         }
 
-        if (nib > NIB) {
+        if (nib > nib_mask) {
             return NULL;
         }
 
@@ -673,7 +754,7 @@ static struct critnib_leaf *find_successor(struct critnib_node *__restrict n) {
  * internal: find_ge -- recursively search >= in a subtree
  */
 static struct critnib_leaf *find_ge(struct critnib_node *__restrict n,
-                                    word key) {
+                                    word key, word nib_mask) {
     if (!n) {
         return NULL;
     }
@@ -683,25 +764,25 @@ static struct critnib_leaf *find_ge(struct critnib_node *__restrict n,
         return (k->key >= key) ? k : NULL;
     }
 
-    if ((key ^ n->path) >> (n->shift) & ~NIB) {
+    if ((key ^ n->path) >> (n->shift) & ~nib_mask) {
         if (n->path > key) {
-            return find_successor(n);
+            return find_successor(n, nib_mask);
         }
 
         return NULL;
     }
 
-    unsigned nib = slice_index(key, n->shift);
+    unsigned nib = slice_index(nib_mask, key, n->shift);
     {
         struct critnib_node *m;
         load(&n->child[nib], &m);
-        struct critnib_leaf *k = find_ge(m, key);
+        struct critnib_leaf *k = find_ge(m, key, nib_mask);
         if (k) {
             return k;
         }
     }
 
-    for (; nib < NIB; nib++) {
+    for (; nib < nib_mask; nib++) {
         struct critnib_node *m;
         load(&n->child[nib + 1], &m);
         if (m) {
@@ -710,7 +791,7 @@ static struct critnib_leaf *find_ge(struct critnib_node *__restrict n,
                 return to_leaf(n);
             }
 
-            return find_successor(n);
+            return find_successor(n, nib_mask);
         }
     }
 
@@ -726,6 +807,7 @@ int critnib_find(struct critnib *c, uintptr_t key, enum find_dir_t dir,
     struct critnib_leaf *k;
     uintptr_t _rkey = (uintptr_t)0x0;
     void **_rvalue = NULL;
+    word nib = c->nib;
 
     /* <42 ≡ ≤41 */
     if (dir < -1) {
@@ -746,12 +828,12 @@ int critnib_find(struct critnib *c, uintptr_t key, enum find_dir_t dir,
         load(&c->root, &n);
 
         if (dir < 0) {
-            k = find_le(n, key);
+            k = find_le(n, key, nib);
         } else if (dir > 0) {
-            k = find_ge(n, key);
+            k = find_ge(n, key, nib);
         } else {
             while (n && !is_leaf(n)) {
-                load(&n->child[slice_index(key, n->shift)], &n);
+                load(&n->child[slice_index(nib, key, n->shift)], &n);
             }
 
             struct critnib_leaf *kk = to_leaf(n);
@@ -782,7 +864,8 @@ int critnib_find(struct critnib *c, uintptr_t key, enum find_dir_t dir,
  *
  * If func() returns non-zero, the search is aborted.
  */
-static int iter(struct critnib_node *__restrict n, word min, word max,
+static int iter(struct critnib *c, struct critnib_node *__restrict n,
+                word min, word max,
                 int (*func)(word key, void *value, void *privdata),
                 void *privdata) {
     if (is_leaf(n)) {
@@ -796,13 +879,13 @@ static int iter(struct critnib_node *__restrict n, word min, word max,
     if (n->path > max) {
         return 1;
     }
-    if ((n->path | path_mask(n->shift)) < min) {
+    if ((n->path | path_mask(c->nib, n->shift)) < min) {
         return 0;
     }
 
-    for (int i = 0; i < SLNODES; i++) {
+    for (unsigned i = 0; i < c->slnodes; i++) {
         struct critnib_node *__restrict m = n->child[i];
-        if (m && iter(m, min, max, func, privdata)) {
+        if (m && iter(c, m, min, max, func, privdata)) {
             return 1;
         }
     }
@@ -815,7 +898,20 @@ void critnib_iter(critnib *c, uintptr_t min, uintptr_t max,
                   void *privdata) {
     utils_mutex_lock(&c->mutex);
     if (c->root) {
-        iter(c->root, min, max, func, privdata);
+        iter(c, c->root, min, max, func, privdata);
     }
     utils_mutex_unlock(&c->mutex);
 }
+
+/*
+ * critnib_memory_usage -- return the number of bytes of nodes and leaves
+ * allocated by the critnib (including ones kept for reuse)
+ */
+size_t critnib_memory_usage(critnib *c) {
+    utils_mutex_lock(&c->mutex);
+    size_t size = c->n_nodes * c->node_size +
+                  c->n_leaves * sizeof(struct critnib_leaf);
+    utils_mutex_unlock(&c->mutex);
+
+    return size;
+}
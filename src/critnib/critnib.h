@@ -10,6 +10,7 @@
 #ifndef UMF_CRITNIB_H
 #define UMF_CRITNIB_H 1
 
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -28,10 +29,13 @@ enum find_dir_t {
 };
 
 critnib *critnib_new(void);
+critnib *critnib_new_with_slice(unsigned slice);
 void critnib_delete(critnib *c);
 
 int critnib_insert(critnib *c, uintptr_t key, void *value, int update);
 void *critnib_remove(critnib *c, uintptr_t key);
+size_t critnib_remove_batch(critnib *c, const uintptr_t *keys, void **values,
+                            size_t n);
 void *critnib_get(critnib *c, uintptr_t key);
 void *critnib_find_le(critnib *c, uintptr_t key);
 int critnib_find(critnib *c, uintptr_t key, enum find_dir_t dir,
@@ -39,6 +43,7 @@ int critnib_find(critnib *c, uintptr_t key, enum find_dir_t dir,
 void critnib_iter(critnib *c, uintptr_t min, uintptr_t max,
                   int (*func)(uintptr_t key, void *value, void *privdata),
                   void *privdata);
+size_t critnib_memory_usage(critnib *c);
 
 #ifdef __cplusplus
 }
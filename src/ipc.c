@@ -9,12 +9,14 @@
 
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <umf/ipc.h>
 
 #include "base_alloc_global.h"
 #include "ipc_internal.h"
 #include "memory_pool_internal.h"
+#include "memory_provider_internal.h"
 #include "provider/provider_tracking.h"
 #include "utils_common.h"
 #include "utils_log.h"
@@ -49,6 +51,91 @@ umf_result_t umfPoolGetIPCHandleSize(umf_memory_pool_handle_t hPool,
     return ret;
 }
 
+// Type of the memory provider of the pool stored in IPC handles:
+// FNV-1a hash of the name of the (upstream) memory provider.
+static uint32_t getIPCProviderType(umf_memory_pool_handle_t hPool) {
+    umf_memory_provider_handle_t hProvider = NULL;
+    if (umfPoolGetMemoryProvider(hPool, &hProvider) != UMF_RESULT_SUCCESS) {
+        return 0;
+    }
+
+    const char *name = umfMemoryProviderGetName(hProvider);
+    uint32_t hash = 2166136261u;
+    for (; name && *name; name++) {
+        hash ^= (uint8_t)*name;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+// Write the IPC handle of ptr from the base allocation described by
+// allocInfo to ipcData. If sameBase is not NULL, it is a handle of the same
+// base allocation and its provider-specific data is copied.
+static umf_result_t getIPCHandle(const void *ptr,
+                                 const umf_alloc_info_t *allocInfo,
+                                 size_t ipcHandleSize, uint32_t providerType,
+                                 const umf_ipc_data_t *sameBase,
+                                 umf_ipc_data_t *ipcData) {
+    if (sameBase) {
+        memcpy(ipcData, sameBase, ipcHandleSize);
+    } else {
+        memset(ipcData, 0, sizeof(*ipcData));
+
+        // We cannot use umfPoolGetMemoryProvider function because it returns
+        // upstream provider but we need tracking one
+        umf_memory_provider_handle_t provider = allocInfo->pool->provider;
+        assert(provider);
+
+        // the tracking provider sets the generation in the header
+        umf_result_t ret = umfMemoryProviderGetIPCHandle(
+            provider, allocInfo->base, allocInfo->baseSize,
+            (void *)ipcData->providerIpcData);
+        if (ret != UMF_RESULT_SUCCESS) {
+            LOG_ERR("failed to get IPC handle.");
+            return ret;
+        }
+    }
+
+    ipcData->magic = UMF_IPC_DATA_MAGIC;
+    ipcData->version = UMF_IPC_DATA_VERSION;
+    ipcData->headerSize = (uint16_t)sizeof(umf_ipc_data_t);
+    ipcData->handleSize = (uint32_t)ipcHandleSize;
+    ipcData->providerType = providerType;
+    ipcData->pid = utils_getpid();
+    ipcData->baseSize = allocInfo->baseSize;
+    ipcData->offset = (uintptr_t)ptr - (uintptr_t)allocInfo->base;
+
+    return UMF_RESULT_SUCCESS;
+}
+
+// Check that the IPC handle was created by a compatible version of UMF
+// for a pool with the given type of memory provider.
+static umf_result_t checkIPCHandle(const umf_ipc_data_t *ipcData,
+                                   uint32_t providerType) {
+    if (ipcData->magic != UMF_IPC_DATA_MAGIC) {
+        LOG_ERR("invalid IPC handle: wrong magic number.");
+        return UMF_RESULT_ERROR_INVALID_ARGUMENT;
+    }
+
+    if (ipcData->version != UMF_IPC_DATA_VERSION ||
+        ipcData->headerSize != sizeof(umf_ipc_data_t)) {
+        LOG_ERR("unsupported IPC handle version: %u.",
+                (unsigned)ipcData->version);
+        return UMF_RESULT_ERROR_INVALID_ARGUMENT;
+    }
+
+    // the size of provider-specific data can differ between processes
+    // (e.g. it contains a name of a file), so it is not compared
+    if (ipcData->handleSize < sizeof(umf_ipc_data_t) ||
+        ipcData->providerType != providerType) {
+        LOG_ERR("IPC handle was created by another type of memory provider.");
+        return UMF_RESULT_ERROR_INVALID_ARGUMENT;
+    }
+
+    return UMF_RESULT_SUCCESS;
+}
+
 umf_result_t umfGetIPCHandle(const void *ptr, umf_ipc_handle_t *umfIPCHandle,
                              size_t *size) {
     if (ptr == NULL || umfIPCHandle == NULL || size == NULL) {
@@ -76,30 +163,133 @@ umf_result_t umfGetIPCHandle(const void *ptr, umf_ipc_handle_t *umfIPCHandle,
         return UMF_RESULT_ERROR_OUT_OF_HOST_MEMORY;
     }
 
-    // We cannot use umfPoolGetMemoryProvider function because it returns
-    // upstream provider but we need tracking one
-    umf_memory_provider_handle_t provider = allocInfo.pool->provider;
-    assert(provider);
-
-    ret = umfMemoryProviderGetIPCHandle(provider, allocInfo.base,
-                                        allocInfo.baseSize,
-                                        (void *)ipcData->providerIpcData);
+    ret = getIPCHandle(ptr, &allocInfo, ipcHandleSize,
+                       getIPCProviderType(allocInfo.pool), NULL, ipcData);
     if (ret != UMF_RESULT_SUCCESS) {
-        LOG_ERR("failed to get IPC handle.");
         umf_ba_global_free(ipcData);
         return ret;
     }
 
-    ipcData->pid = utils_getpid();
-    ipcData->baseSize = allocInfo.baseSize;
-    ipcData->offset = (uintptr_t)ptr - (uintptr_t)allocInfo.base;
-
     *umfIPCHandle = ipcData;
     *size = ipcHandleSize;
 
     return ret;
 }
 
+umf_result_t umfGetIPCHandleToBuffer(const void *ptr, void *buffer,
+                                     size_t bufferSize) {
+    if (ptr == NULL || buffer == NULL) {
+        LOG_ERR("invalid argument.");
+        return UMF_RESULT_ERROR_INVALID_ARGUMENT;
+    }
+
+    if ((uintptr_t)buffer % sizeof(uint64_t)) {
+        LOG_ERR("buffer = %p is not aligned to %zu bytes.", buffer,
+                sizeof(uint64_t));
+        return UMF_RESULT_ERROR_INVALID_ARGUMENT;
+    }
+
+    size_t ipcHandleSize = 0;
+    umf_alloc_info_t allocInfo;
+    umf_result_t ret = umfMemoryTrackerGetAllocInfo(ptr, &allocInfo);
+    if (ret != UMF_RESULT_SUCCESS) {
+        LOG_ERR("cannot get alloc info for ptr = %p.", ptr);
+        return ret;
+    }
+
+    ret = umfPoolGetIPCHandleSize(allocInfo.pool, &ipcHandleSize);
+    if (ret != UMF_RESULT_SUCCESS) {
+        LOG_ERR("cannot get IPC handle size.");
+        return ret;
+    }
+
+    if (bufferSize < ipcHandleSize) {
+        LOG_ERR("buffer is too small: %zu bytes, %zu bytes are required.",
+                bufferSize, ipcHandleSize);
+        return UMF_RESULT_ERROR_INVALID_ARGUMENT;
+    }
+
+    return getIPCHandle(ptr, &allocInfo, ipcHandleSize,
+                        getIPCProviderType(allocInfo.pool), NULL,
+                        (umf_ipc_data_t *)buffer);
+}
+
+umf_result_t umfGetIPCHandles(const void *const *ptrs, size_t count,
+                              umf_ipc_handle_t *ipcHandles, size_t *sizes) {
+    if (ptrs == NULL || ipcHandles == NULL || sizes == NULL) {
+        LOG_ERR("invalid argument.");
+        return UMF_RESULT_ERROR_INVALID_ARGUMENT;
+    }
+
+    umf_result_t ret = UMF_RESULT_SUCCESS;
+    umf_alloc_info_t allocInfo = {NULL, 0, NULL, false};
+    umf_memory_pool_handle_t hPool = NULL;
+    size_t ipcHandleSize = 0;
+    uint32_t providerType = 0;
+    const umf_ipc_data_t *sameBase = NULL;
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        const void *ptr = ptrs[i];
+        if (ptr == NULL) {
+            LOG_ERR("pointer %zu is NULL.", i);
+            ret = UMF_RESULT_ERROR_INVALID_ARGUMENT;
+            goto err_put_handles;
+        }
+
+        // the tracker is looked up only for a pointer outside of
+        // the base allocation of the previous one
+        if (!allocInfo.base || (uintptr_t)ptr < (uintptr_t)allocInfo.base ||
+            (uintptr_t)ptr - (uintptr_t)allocInfo.base >= allocInfo.baseSize) {
+            ret = umfMemoryTrackerGetAllocInfo(ptr, &allocInfo);
+            if (ret != UMF_RESULT_SUCCESS) {
+                LOG_ERR("cannot get alloc info for ptr = %p.", ptr);
+                goto err_put_handles;
+            }
+
+            if (allocInfo.pool != hPool) {
+                hPool = allocInfo.pool;
+                ret = umfPoolGetIPCHandleSize(hPool, &ipcHandleSize);
+                if (ret != UMF_RESULT_SUCCESS) {
+                    LOG_ERR("cannot get IPC handle size.");
+                    goto err_put_handles;
+                }
+                providerType = getIPCProviderType(hPool);
+            }
+
+            sameBase = NULL;
+        }
+
+        ipcHandles[i] = umf_ba_global_alloc(ipcHandleSize);
+        if (!ipcHandles[i]) {
+            LOG_ERR("failed to allocate ipcData");
+            ret = UMF_RESULT_ERROR_OUT_OF_HOST_MEMORY;
+            goto err_put_handles;
+        }
+
+        ret = getIPCHandle(ptr, &allocInfo, ipcHandleSize, providerType,
+                           sameBase, ipcHandles[i]);
+        if (ret != UMF_RESULT_SUCCESS) {
+            umf_ba_global_free(ipcHandles[i]);
+            ipcHandles[i] = NULL;
+            goto err_put_handles;
+        }
+
+        sizes[i] = ipcHandleSize;
+        sameBase = ipcHandles[i];
+    }
+
+    return UMF_RESULT_SUCCESS;
+
+err_put_handles:
+    for (size_t j = 0; j < i; j++) {
+        umfPutIPCHandle(ipcHandles[j]);
+        ipcHandles[j] = NULL;
+    }
+
+    return ret;
+}
+
 umf_result_t umfPutIPCHandle(umf_ipc_handle_t umfIPCHandle) {
     umf_result_t ret = UMF_RESULT_SUCCESS;
 
@@ -125,7 +315,20 @@ umf_result_t umfOpenIPCHandle(umf_memory_pool_handle_t hPool,
     umf_memory_provider_handle_t hProvider = hPool->provider;
     void *base = NULL;
 
-    umf_result_t ret = umfMemoryProviderOpenIPCHandle(
+    // fails if the memory provider does not support IPC
+    size_t ipcHandleSize = 0;
+    umf_result_t ret = umfPoolGetIPCHandleSize(hPool, &ipcHandleSize);
+    if (ret != UMF_RESULT_SUCCESS) {
+        LOG_ERR("cannot get IPC handle size.");
+        return ret;
+    }
+
+    ret = checkIPCHandle(umfIPCHandle, getIPCProviderType(hPool));
+    if (ret != UMF_RESULT_SUCCESS) {
+        return ret;
+    }
+
+    ret = umfMemoryProviderOpenIPCHandle(
         hProvider, (void *)umfIPCHandle->providerIpcData, &base);
     if (ret != UMF_RESULT_SUCCESS) {
         LOG_ERR("memory provider failed to open the IPC handle.");
@@ -136,6 +339,74 @@ umf_result_t umfOpenIPCHandle(umf_memory_pool_handle_t hPool,
     return UMF_RESULT_SUCCESS;
 }
 
+umf_result_t umfOpenIPCHandles(umf_memory_pool_handle_t hPool,
+                               const umf_ipc_handle_t *ipcHandles,
+                               size_t count, void **ptrs) {
+    if (hPool == NULL || ipcHandles == NULL || ptrs == NULL) {
+        LOG_ERR("invalid argument.");
+        return UMF_RESULT_ERROR_INVALID_ARGUMENT;
+    }
+
+    // fails if the memory provider does not support IPC
+    size_t ipcHandleSize = 0;
+    umf_result_t ret = umfPoolGetIPCHandleSize(hPool, &ipcHandleSize);
+    if (ret != UMF_RESULT_SUCCESS) {
+        LOG_ERR("cannot get IPC handle size.");
+        return ret;
+    }
+
+    uint32_t providerType = getIPCProviderType(hPool);
+    for (size_t i = 0; i < count; i++) {
+        if (ipcHandles[i] == NULL) {
+            LOG_ERR("IPC handle %zu is NULL.", i);
+            return UMF_RESULT_ERROR_INVALID_ARGUMENT;
+        }
+
+        ret = checkIPCHandle(ipcHandles[i], providerType);
+        if (ret != UMF_RESULT_SUCCESS) {
+            LOG_ERR("IPC handle %zu is invalid.", i);
+            return ret;
+        }
+    }
+
+    if (hPool->flags & UMF_POOL_CREATE_FLAG_DISABLE_TRACKING) {
+        // no cache of opened handles, open them one by one
+        size_t i;
+        for (i = 0; i < count; i++) {
+            ret = umfMemoryProviderOpenIPCHandle(
+                hPool->provider, (void *)ipcHandles[i]->providerIpcData,
+                &ptrs[i]);
+            if (ret != UMF_RESULT_SUCCESS) {
+                LOG_ERR("memory provider failed to open the IPC handle.");
+                break;
+            }
+        }
+
+        if (ret != UMF_RESULT_SUCCESS) {
+            for (size_t j = 0; j < i; j++) {
+                (void)umfMemoryProviderCloseIPCHandle(
+                    hPool->provider, ptrs[j], ipcHandles[j]->baseSize);
+                ptrs[j] = NULL;
+            }
+            return ret;
+        }
+    } else {
+        ret = umfTrackingMemoryProviderOpenIPCHandles(
+            umfMemoryProviderGetPriv(hPool->provider), ipcHandles, count,
+            ptrs);
+        if (ret != UMF_RESULT_SUCCESS) {
+            LOG_ERR("failed to open the IPC handles.");
+            return ret;
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        ptrs[i] = (void *)((uintptr_t)ptrs[i] + ipcHandles[i]->offset);
+    }
+
+    return UMF_RESULT_SUCCESS;
+}
+
 umf_result_t umfCloseIPCHandle(void *ptr) {
     umf_alloc_info_t allocInfo;
     umf_result_t ret = umfMemoryTrackerGetAllocInfo(ptr, &allocInfo);
@@ -151,3 +422,37 @@ umf_result_t umfCloseIPCHandle(void *ptr) {
     return umfMemoryProviderCloseIPCHandle(hProvider, allocInfo.base,
                                            allocInfo.baseSize);
 }
+
+umf_result_t umfPoolSetIPCCacheCapacity(umf_memory_pool_handle_t hPool,
+                                        umf_ipc_cache_t cache,
+                                        size_t capacity) {
+    if (hPool == NULL) {
+        LOG_ERR("pool handle is NULL.");
+        return UMF_RESULT_ERROR_INVALID_ARGUMENT;
+    }
+
+    if (hPool->flags & UMF_POOL_CREATE_FLAG_DISABLE_TRACKING) {
+        LOG_ERR("IPC caches are not available in pools without tracking.");
+        return UMF_RESULT_ERROR_NOT_SUPPORTED;
+    }
+
+    return umfTrackingMemoryProviderSetIPCCacheCapacity(
+        umfMemoryProviderGetPriv(hPool->provider), cache, capacity);
+}
+
+umf_result_t umfPoolGetIPCCacheStats(umf_memory_pool_handle_t hPool,
+                                     umf_ipc_cache_t cache,
+                                     umf_ipc_cache_stats_t *stats) {
+    if (hPool == NULL || stats == NULL) {
+        LOG_ERR("invalid argument.");
+        return UMF_RESULT_ERROR_INVALID_ARGUMENT;
+    }
+
+    if (hPool->flags & UMF_POOL_CREATE_FLAG_DISABLE_TRACKING) {
+        LOG_ERR("IPC caches are not available in pools without tracking.");
+        return UMF_RESULT_ERROR_NOT_SUPPORTED;
+    }
+
+    return umfTrackingMemoryProviderGetIPCCacheStats(
+        umfMemoryProviderGetPriv(hPool->provider), cache, stats);
+}
@@ -10,19 +10,34 @@
 #ifndef UMF_IPC_INTERNAL_H
 #define UMF_IPC_INTERNAL_H 1
 
+#include <stdint.h>
+
 #include <umf/base.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+#define UMF_IPC_DATA_MAGIC 0x48435049 // "IPCH" in little-endian byte order
+#define UMF_IPC_DATA_VERSION 1
+
 // UMF representation of IPC handle. It contains UMF-specific common data
 // and provider-specific IPC data, stored in providerIpcData.
 // providerIpcData is a Flexible Array Member because its size varies
 // depending on the provider.
+// The header has a fixed layout of fixed-width fields, so the handle can be
+// copied as is into any buffer of the same host (e.g. a shared ring) and
+// validated by the consumer before it is opened.
 typedef struct umf_ipc_data_t {
-    int pid;         // process ID of the process that allocated the memory
-    size_t baseSize; // size of base (coarse-grain) allocation
+    uint32_t magic;        // UMF_IPC_DATA_MAGIC
+    uint16_t version;      // UMF_IPC_DATA_VERSION
+    uint16_t headerSize;   // sizeof(umf_ipc_data_t)
+    uint32_t handleSize;   // size of the whole handle
+    uint32_t providerType; // hash of the name of the memory provider
+    int32_t pid;           // ID of the process that allocated the memory
+    uint32_t reserved;     // has to be zero
+    uint64_t generation;   // generation of the base allocation in producer
+    uint64_t baseSize;     // size of base (coarse-grain) allocation
     uint64_t offset;
     char providerIpcData[];
 } umf_ipc_data_t;
@@ -44,8 +44,9 @@ static umf_result_t umfPoolCreateInternal(const umf_memory_pool_ops_t *ops,
         // Wrap provider with memory tracking provider.
         // Check if the provider supports the free() operation.
         bool upstreamDoesNotFree = umfIsFreeOpDefault(provider);
+        bool coarse = flags & UMF_POOL_CREATE_FLAG_COARSE_TRACKING;
         ret = umfTrackingMemoryProviderCreate(provider, pool, &pool->provider,
-                                              upstreamDoesNotFree);
+                                              upstreamDoesNotFree, coarse);
         if (ret != UMF_RESULT_SUCCESS) {
             goto err_provider_create;
         }
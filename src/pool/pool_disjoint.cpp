@@ -8,25 +8,25 @@
 #include <bitset>
 #include <cassert>
 #include <cctype>
-#include <iomanip>
+#include <cstdio>
+#include <chrono>
+#include <cstring>
 #include <limits>
-#include <list>
 #include <memory>
 #include <mutex>
-#include <shared_mutex>
-#include <string>
-#include <unordered_map>
 #include <utility>
 #include <vector>
 
-// TODO: replace with logger?
-#include <iostream>
-
+#include "base_alloc/base_alloc_global.h"
+#include "critnib/critnib.h"
 #include "provider/provider_tracking.h"
 
 #include "../cpp_helpers.hpp"
+#include "memory_pool_internal.h"
 #include "pool_disjoint.h"
 #include "umf.h"
+#include "utils_common.h"
+#include "utils_concurrency.h"
 #include "utils_log.h"
 #include "utils_math.h"
 #include "utils_sanitizers.h"
@@ -38,6 +38,25 @@
 #define POISON_MEMORY 0
 #endif
 
+// Tracing of every allocation and free (PoolTrace > 2) is compiled in only if
+// TRACE_POOL_OPERATIONS is set, so that it costs nothing otherwise.
+#ifndef TRACE_POOL_OPERATIONS
+#define TRACE_POOL_OPERATIONS 0
+#endif
+
+#if (TRACE_POOL_OPERATIONS != 0)
+#define TRACE_POOL_OPERATION(Impl, ...)                                        \
+    do {                                                                       \
+        if ((Impl)->getParams().PoolTrace > 2) {                               \
+            LOG_DEBUG(__VA_ARGS__);                                            \
+        }                                                                      \
+    } while (0)
+#else
+#define TRACE_POOL_OPERATION(Impl, ...)                                        \
+    do {                                                                       \
+    } while (0)
+#endif
+
 static inline void annotate_memory_inaccessible([[maybe_unused]] void *ptr,
                                                 [[maybe_unused]] size_t size) {
 #if (POISON_MEMORY != 0)
@@ -71,6 +90,10 @@ class DisjointPool {
     size_t malloc_usable_size(void *);
     umf_result_t free(void *ptr);
     umf_result_t get_last_allocation_error();
+    umf_result_t trim();
+    umf_result_t get_stats(umf_disjoint_pool_stats_t *Stats,
+                           umf_disjoint_pool_bucket_stats_t *BucketStats,
+                           size_t *NumBuckets);
 
     DisjointPool();
     ~DisjointPool();
@@ -134,26 +157,104 @@ static size_t AlignUp(size_t Val, size_t Alignment) {
     return (Val + Alignment - 1) & (~(Alignment - 1));
 }
 
+using Clock = std::chrono::steady_clock;
+
 typedef struct MemoryProviderError {
     umf_result_t code;
 } MemoryProviderError_t;
 
 class Bucket;
 
+// A block of memory allocated from the memory provider at once and split into
+// slots of equal size, each holding the memory of one slab (see
+// SlabExtentSize). The free slots are kept in a bitmap stored right after the
+// structure, see AllocImpl::allocSlabMemory().
+struct SlabExtent {
+    void *MemPtr;
+    size_t NumFree;
+
+    // Slots from this one on have never been used, so their memory is
+    // as returned by the memory provider. Free slots are taken lowest first.
+    size_t FreshFrom;
+
+    // Links of the list of extents with free slots
+    SlabExtent *Prev;
+    SlabExtent *Next;
+
+    uint64_t *getBitmap() { return reinterpret_cast<uint64_t *>(this + 1); }
+};
+
+// Allocation counters of a bucket. They are read without locking by
+// umfDisjointPoolGetStats(), so they are relaxed atomics.
+struct BucketCounters {
+    std::atomic<size_t> AllocCount{0};
+    std::atomic<size_t> AllocPoolCount{0};
+    std::atomic<size_t> FreeCount{0};
+    std::atomic<size_t> BytesRequested{0};
+
+    // Counters of a thread cache are written only by the owning thread,
+    // which can then avoid the atomic read-modify-write.
+    static void add(std::atomic<size_t> &Counter, size_t Value, bool Owned) {
+        if (Owned) {
+            Counter.store(Counter.load(std::memory_order_relaxed) + Value,
+                          std::memory_order_relaxed);
+        } else {
+            Counter.fetch_add(Value, std::memory_order_relaxed);
+        }
+    }
+
+    void countAlloc(size_t Size, bool FromPool, bool Owned = false) {
+        add(AllocCount, 1, Owned);
+        if (FromPool) {
+            add(AllocPoolCount, 1, Owned);
+        }
+        add(BytesRequested, Size, Owned);
+    }
+
+    void countFree(bool Owned = false) { add(FreeCount, 1, Owned); }
+
+    // Add all counters of Other to this one.
+    void add(const BucketCounters &Other) {
+        add(AllocCount, Other.AllocCount.load(std::memory_order_relaxed),
+            false);
+        add(AllocPoolCount,
+            Other.AllocPoolCount.load(std::memory_order_relaxed), false);
+        add(FreeCount, Other.FreeCount.load(std::memory_order_relaxed), false);
+        add(BytesRequested,
+            Other.BytesRequested.load(std::memory_order_relaxed), false);
+    }
+
+    void addTo(umf_disjoint_pool_bucket_stats_t &Stats) const {
+        Stats.AllocCount += AllocCount.load(std::memory_order_relaxed);
+        Stats.AllocPoolCount += AllocPoolCount.load(std::memory_order_relaxed);
+        Stats.FreeCount += FreeCount.load(std::memory_order_relaxed);
+        Stats.BytesRequested += BytesRequested.load(std::memory_order_relaxed);
+    }
+};
+
 // Represents the allocated memory block of size 'SlabMinSize'
 // Internally, it splits the memory block into chunks. The number of
 // chunks depends of the size of a Bucket which created the Slab.
 // Note: Bucket's methods are responsible for thread safety of Slab access,
 // so no locking happens here.
+// The state of the chunks is kept in a bitmap of 'NumBitmapWords' words,
+// stored right after the Slab object, so slabs must be created with
+// Slab::create() and destroyed with Slab::destroy().
 class Slab {
 
     // Pointer to the allocated memory of SlabMinSize bytes
     void *MemPtr;
 
-    // Represents the current state of each chunk:
-    // if the bit is set then the chunk is allocated
-    // the chunk is free for allocation otherwise
-    std::vector<bool> Chunks;
+    // The extent the memory was carved from, nullptr if it was allocated
+    // directly from the memory provider
+    SlabExtent *Extent = nullptr;
+
+    // Whether the memory has not been used since it was allocated from
+    // the memory provider
+    bool FreshMemory = false;
+
+    // Number of chunks in the slab
+    const size_t NumChunks;
 
     // Total number of allocated chunks at the moment.
     size_t NumAllocated = 0;
@@ -161,33 +262,69 @@ class Slab {
     // The bucket which the slab belongs to
     Bucket &bucket;
 
-    using ListIter = std::list<std::unique_ptr<Slab>>::iterator;
+    // Links of the avail/unavail list of the bucket the slab is on
+    Slab *Prev = nullptr;
+    Slab *Next = nullptr;
+    friend class SlabList;
+
+    // Time when the slab was put in the pool, and whether it has been purged
+    // since then.
+    Clock::time_point PooledTime;
+    bool Purged = false;
 
-    // Store iterator to the corresponding node in avail/unavail list
-    // to achieve O(1) removal
-    ListIter SlabListIter;
+    // Hints where to start search for free chunk in a slab: all bitmap
+    // words before this one have no free chunks.
+    size_t FirstFreeWordIdx = 0;
 
-    // Hints where to start search for free chunk in a slab
-    size_t FirstFreeChunkIdx = 0;
+    // Represents the current state of each chunk:
+    // if the bit is set then the chunk is free for allocation
+    // the chunk is allocated otherwise
+    uint64_t *getBitmap() { return reinterpret_cast<uint64_t *>(this + 1); }
+    const uint64_t *getBitmap() const {
+        return reinterpret_cast<const uint64_t *>(this + 1);
+    }
+
+    static size_t NumBitmapWords(size_t NumChunks) {
+        return (NumChunks + 63) / 64;
+    }
 
     // Return the index of the first available chunk, SIZE_MAX otherwise
     size_t FindFirstAvailableChunkIdx() const;
 
-    // Register/Unregister the slab in the global slab address map.
-    void regSlab(Slab &);
-    void unregSlab(Slab &);
-    static void regSlabByAddr(void *, Slab &);
-    static void unregSlabByAddr(void *, Slab &);
+    // Register/Unregister the slab in the slab address index of the pool.
+    void regSlab();
+    void unregSlab();
 
-  public:
-    Slab(Bucket &);
+    Slab(Bucket &, size_t NumChunks);
     ~Slab();
 
-    void setIterator(ListIter It) { SlabListIter = It; }
-    ListIter getIterator() const { return SlabListIter; }
+  public:
+    // Allocate a new slab of the given bucket together with its bitmap.
+    // The descriptor is allocated with the base allocator, so no system
+    // malloc() is called from within the pool.
+    static Slab *create(Bucket &);
+    static void destroy(Slab *);
+
+    // The next slab on the same list, nullptr if this one is the last
+    Slab *getNext() const { return Next; }
 
     size_t getNumAllocated() const { return NumAllocated; }
 
+    // Note that the slab was put in the pool at the given time.
+    void setPooled(Clock::time_point Now) {
+        PooledTime = Now;
+        Purged = false;
+    }
+    Clock::time_point getPooledTime() const { return PooledTime; }
+
+    // Purge the memory of the slab, which must be entirely free.
+    void purge();
+    bool isPurged() const { return Purged; }
+
+    // Whether the memory of the slab has not been used before, not even by
+    // an earlier slab, see ProviderMemoryZeroed.
+    bool hasFreshMemory() const { return FreshMemory; }
+
     // Get pointer to allocation that is one piece of this slab.
     void *getChunk();
 
@@ -198,7 +335,10 @@ class Slab {
     void *getEnd() const;
 
     size_t getChunkSize() const;
-    size_t getNumChunks() const { return Chunks.size(); }
+    size_t getNumChunks() const { return NumChunks; }
+
+    // Get the beginning of the chunk the given pointer points into.
+    void *getChunkStart(void *Ptr) const;
 
     bool hasAvail();
 
@@ -208,18 +348,65 @@ class Slab {
     void freeChunk(void *Ptr);
 };
 
+// Intrusive doubly linked list of slabs. The list does not own the slabs.
+class SlabList {
+    Slab *Head = nullptr;
+    size_t Size = 0;
+
+  public:
+    bool empty() const { return Head == nullptr; }
+    size_t size() const { return Size; }
+    Slab *front() const { return Head; }
+
+    void pushFront(Slab &S) {
+        S.Prev = nullptr;
+        S.Next = Head;
+        if (Head) {
+            Head->Prev = &S;
+        }
+        Head = &S;
+        Size++;
+    }
+
+    void remove(Slab &S) {
+        assert(Size > 0 && (S.Prev || Head == &S));
+        if (S.Prev) {
+            S.Prev->Next = S.Next;
+        } else {
+            Head = S.Next;
+        }
+        if (S.Next) {
+            S.Next->Prev = S.Prev;
+        }
+        S.Prev = S.Next = nullptr;
+        Size--;
+    }
+};
+
 class Bucket {
     const size_t Size;
 
+    // Alignment of memory of slabs requested from the memory provider,
+    // 0 for the default one.
+    const size_t SlabAlignment;
+
     // List of slabs which have at least 1 available chunk.
-    std::list<std::unique_ptr<Slab>> AvailableSlabs;
+    SlabList AvailableSlabs;
 
     // List of slabs with 0 available chunk.
-    std::list<std::unique_ptr<Slab>> UnavailableSlabs;
+    SlabList UnavailableSlabs;
 
     // Protects the bucket and all the corresponding slabs
     std::mutex BucketLock;
 
+    // Slots of chunks freed while the lock was held by another thread,
+    // drained by the next thread taking the lock. They are kept aside,
+    // because the memory of the pool might not be accessible by the CPU
+    // (e.g. device memory). HasRemoteFrees is set after a slot is filled.
+    static constexpr size_t RemoteFreeSlots = 32;
+    std::array<std::atomic<void *>, RemoteFreeSlots> RemoteFrees{};
+    std::atomic<bool> HasRemoteFrees{false};
+
     // Reference to the allocator context, used access memory allocation
     // routines, slab map and etc.
     DisjointPool::AllocImpl &OwnAllocCtx;
@@ -243,40 +430,56 @@ class Bucket {
     // if a slab in this bucket is already pooled.
     size_t chunkedSlabsInPool;
 
-    // Statistics
-    size_t allocPoolCount;
-    size_t freeCount;
-    size_t currSlabsInUse;
-    size_t currSlabsInPool;
-    size_t maxSlabsInPool;
+    // The earliest time when any pooled slab is due to be purged or released.
+    Clock::time_point NextDecayTime = Clock::time_point::max();
+
+    // Statistics of slabs, written under the lock and read without it
+    std::atomic<size_t> currSlabsInUse{0};
+    std::atomic<size_t> currSlabsInPool{0};
+    std::atomic<size_t> maxSlabsInUse{0};
+    std::atomic<size_t> maxSlabsInPool{0};
 
   public:
-    // Statistics
-    size_t allocCount;
-    size_t maxSlabsInUse;
+    // Allocations and frees not served by a thread cache
+    BucketCounters Counters;
 
-    Bucket(size_t Sz, DisjointPool::AllocImpl &AllocCtx)
-        : Size{Sz}, OwnAllocCtx{AllocCtx}, chunkedSlabsInPool(0),
-          allocPoolCount(0), freeCount(0), currSlabsInUse(0),
-          currSlabsInPool(0), maxSlabsInPool(0), allocCount(0),
-          maxSlabsInUse(0) {}
+    Bucket(size_t Sz, DisjointPool::AllocImpl &AllocCtx,
+           size_t SlabAlign = 0)
+        : Size{Sz}, SlabAlignment{SlabAlign}, OwnAllocCtx{AllocCtx},
+          chunkedSlabsInPool(0) {}
+
+    // Destroys all slabs of the bucket.
+    ~Bucket();
 
     // Get pointer to allocation that is one piece of an available slab in this
     // bucket.
     void *getChunk(bool &FromPool);
 
+    // Get up to 'Count' chunks from this bucket under a single lock.
+    // Returns the number of chunks stored in 'Chunks'.
+    size_t getChunks(void **Chunks, size_t Count, bool &FromPool);
+
     // Get pointer to allocation that is a full slab in this bucket.
     void *getSlab(bool &FromPool);
 
     // Return the allocation size of this bucket.
     size_t getSize() const { return Size; }
 
+    size_t getSlabAlignment() const { return SlabAlignment; }
+
     // Free an allocation that is one piece of a slab in this bucket.
     void freeChunk(void *Ptr, Slab &Slab, bool &ToPool);
 
+    // Free 'Count' chunks of this bucket under a single lock. Slabs[i] is
+    // the slab which Ptrs[i] belongs to.
+    void freeChunks(void **Ptrs, Slab **Slabs, size_t Count);
+
     // Free an allocation that is a full slab in this bucket.
     void freeSlab(Slab &Slab, bool &ToPool);
 
+    // Release all slabs in the pool of this bucket to the memory provider.
+    void trim();
+
     umf_memory_provider_handle_t getMemHandle();
 
     DisjointPool::AllocImpl &getAllocCtx() { return OwnAllocCtx; }
@@ -299,103 +502,287 @@ class Bucket {
     // The maximum allocation size subject to pooling.
     size_t MaxPoolableSize();
 
-    // Update allocation count
-    void countAlloc(bool FromPool);
-
-    // Update free count
-    void countFree();
-
     // Update statistics of Available/Unavailable
     void updateStats(int InUse, int InPool);
 
-    // Print bucket statistics
-    void printStats(bool &TitlePrinted, const std::string &Label);
+    // Add statistics of this bucket to Stats
+    void addStats(umf_disjoint_pool_bucket_stats_t &Stats) const;
 
   private:
     void onFreeChunk(Slab &, bool &ToPool);
 
+    // Put a chunk in a remote-free slot without taking the lock.
+    // Returns false if all the slots are taken.
+    bool pushRemoteFree(void *Chunk);
+
+    // Free all chunks of the remote-free slots. The lock must be already
+    // acquired.
+    void drainRemoteFrees();
+
+    // Mark the slab as put in the pool and purge/release pooled slabs which
+    // stayed there for too long. The lock must be already acquired.
+    void onPoolSlab(Slab &);
+
+    // Purge and release pooled slabs according to the decay delays; release
+    // all pooled slabs if Force is set. The lock must be already acquired.
+    void decay(Clock::time_point Now, bool Force);
+
+    // Get a chunk from an available slab, the lock must be already acquired.
+    void *getChunkLocked(bool &FromPool);
+
     // Update statistics of pool usage, and indicate that an allocation was made
     // from the pool.
     void decrementPool(bool &FromPool);
 
     // Get a slab to be used for chunked allocations.
-    decltype(AvailableSlabs.begin()) getAvailSlab(bool &FromPool);
+    Slab *getAvailSlab(bool &FromPool);
 
     // Get a slab that will be used as a whole for a single allocation.
-    decltype(AvailableSlabs.begin()) getAvailFullSlab(bool &FromPool);
+    Slab *getAvailFullSlab(bool &FromPool);
 };
 
+class ThreadCache;
+
+// Source of unique pool identifiers, see AllocImpl::PoolId.
+static std::atomic<uint64_t> NextPoolId{1};
+
+// Tag of the value stored in the slab address index under the address of the
+// last byte of a slab (see Slab::regSlab).
+static constexpr uintptr_t SlabEndTag = 1;
+
+// Return the sorted sizes of buckets of a pool with the given configuration.
+static std::vector<size_t>
+makeBucketSizes(const umf_disjoint_pool_params_t &Params) {
+    std::vector<size_t> Sizes;
+
+    if (Params.BucketSizes && Params.NumBucketSizes) {
+        // Custom sizes are rounded up to keep chunks 8-byte aligned.
+        for (size_t I = 0; I < Params.NumBucketSizes; I++) {
+            Sizes.push_back(std::min(
+                AlignUp(Params.BucketSizes[I],
+                        UMF_DISJOINT_POOL_MIN_BUCKET_DEFAULT_SIZE),
+                CutOff));
+        }
+        std::sort(Sizes.begin(), Sizes.end());
+        Sizes.erase(std::unique(Sizes.begin(), Sizes.end()), Sizes.end());
+    } else {
+        // Generate buckets sized such as: 64, 96, 128, 192, ..., CutOff.
+        // Powers of 2 and ClassesPerPowerOf2 - 1 values evenly spaced between
+        // the powers of 2 (by default only the value halfway between them).
+        size_t Classes = Params.ClassesPerPowerOf2 ? Params.ClassesPerPowerOf2
+                                                   : 2;
+        auto Size1 = Params.MinBucketSize;
+        // MinBucketSize cannot be larger than CutOff.
+        Size1 = std::min(Size1, CutOff);
+        // Buckets sized smaller than the bucket default size- 8 aren't needed.
+        Size1 = std::max(Size1, UMF_DISJOINT_POOL_MIN_BUCKET_DEFAULT_SIZE);
+        for (; Size1 < CutOff; Size1 *= 2) {
+            size_t Step = std::max(Size1 / Classes, (size_t)1);
+            for (size_t Size = Size1; Size < 2 * Size1; Size += Step) {
+                Sizes.push_back(Size);
+            }
+        }
+    }
+
+    if (Sizes.empty() || Sizes.back() < CutOff) {
+        Sizes.push_back(CutOff);
+    }
+
+    return Sizes;
+}
+
 class DisjointPool::AllocImpl {
-    // It's important for the map to be destroyed last after buckets and their
-    // slabs This is because slab's destructor removes the object from the map.
-    std::unordered_multimap<void *, Slab &> KnownSlabs;
-    std::shared_timed_mutex KnownSlabsMapLock;
+    // Index of all slabs of the pool, keyed by address. Lookups are lock-free.
+    // It's important for the index to be destroyed last after buckets and
+    // their slabs. This is because slab's destructor removes the slab from
+    // the index.
+    std::unique_ptr<critnib, decltype(&critnib_delete)> KnownSlabs;
+
+    // Sizes of the allocations made directly by the memory provider, keyed
+    // by address, including the ones kept in the large allocation cache.
+    std::unique_ptr<critnib, decltype(&critnib_delete)> LargeAllocs;
+
+    // Unique identifier of this pool instance, used to find the per-thread
+    // cache of this pool. Unlike the address of the pool, it is never reused.
+    const uint64_t PoolId;
+
+    // Per-thread caches created for this pool, protected by
+    // ThreadCacheRegistryLock.
+    std::vector<ThreadCache *> ThreadCaches;
+
+    // Number of buckets (starting from the smallest one) used in chunked mode,
+    // i.e. the number of magazines in each per-thread cache.
+    size_t NumCachedBuckets = 0;
 
     // Handle to the memory provider
     umf_memory_provider_handle_t MemHandle;
 
     // Store as unique_ptrs since Bucket is not Movable(because of std::mutex)
+    // Holds 'NumShards' consecutive sets of 'NumBucketsPerShard' buckets.
     std::vector<std::unique_ptr<Bucket>> Buckets;
 
+    // Number of bucket sets and number of buckets in each of them
+    size_t NumShards = 1;
+    size_t NumBucketsPerShard = 0;
+
+    // Sets of buckets for alignments larger than the provider page size,
+    // indexed by log2 of the alignment. Their slabs are allocated from the
+    // provider with that alignment, so the chunks are aligned without
+    // padding. A set is created on first use under AlignedBucketsLock and
+    // can be used without the lock once marked ready.
+    static constexpr size_t MaxAlignmentLog2 = 31; // log2(CutOff)
+    std::mutex AlignedBucketsLock;
+    std::vector<std::unique_ptr<Bucket>> AlignedBuckets[MaxAlignmentLog2 + 1];
+    std::atomic<bool> AlignedBucketsReady[MaxAlignmentLog2 + 1] = {};
+
     // Configuration for this instance
     umf_disjoint_pool_params_t params;
 
     umf_disjoint_pool_shared_limits_t DefaultSharedLimits = {
         (std::numeric_limits<size_t>::max)(), 0};
 
-    // Used in algorithm for finding buckets
-    std::size_t MinBucketSizeExp;
+    // Used in algorithm for finding buckets: sizes are split into ranges by
+    // their exponent and SizeLUTSubBits following bits, each entry holds
+    // the index of the first bucket which might fit sizes of the range.
+    static constexpr size_t SizeLUTSubBits = 3;
+    std::vector<uint32_t> SizeLUT;
 
     // Coarse-grain allocation min alignment
     size_t ProviderMinPageSize;
 
+    // Statistics of allocations served directly by the memory provider
+    BucketCounters LargeCounters;
+
+    // Extents which memory of slabs is carved from, protected by ExtentsLock.
+    // Extents with free slots are on the PartialExtents list, except for at
+    // most one entirely free extent kept in EmptyExtent.
+    std::mutex ExtentsLock;
+    SlabExtent *PartialExtents = nullptr;
+    SlabExtent *EmptyExtent = nullptr;
+
+    // Size of the memory of a slab in an extent and the number of slabs in
+    // an extent, 0 if extents are not used.
+    size_t ExtentSlotSize = 0;
+    size_t SlotsPerExtent = 0;
+
+    // Cache of freed allocations larger than MaxPoolableSize, see
+    // LargeCacheSize. Entries [0, NumLargeCached) are valid. Protected by
+    // LargeCacheLock.
+    struct LargeCacheEntry {
+        void *Ptr;
+        size_t Size;
+        Clock::time_point FreedTime;
+        bool Purged;
+    };
+    static constexpr size_t LargeCacheCapacity = 64;
+    std::mutex LargeCacheLock;
+    std::array<LargeCacheEntry, LargeCacheCapacity> LargeCache;
+    size_t NumLargeCached = 0;
+    size_t LargeCachedBytes = 0;
+    Clock::time_point LargeCacheNextDecay = Clock::time_point::max();
+
+    // Statistics of memory provider usage
+    std::atomic<size_t> ProviderAllocCount{0};
+    std::atomic<size_t> ProviderFreeCount{0};
+    std::atomic<size_t> ProviderBytes{0};
+
   public:
     AllocImpl(umf_memory_provider_handle_t hProvider,
               umf_disjoint_pool_params_t *params)
-        : MemHandle{hProvider}, params(*params) {
+        : KnownSlabs(critnib_new(), &critnib_delete),
+          LargeAllocs(critnib_new(), &critnib_delete), PoolId(NextPoolId++),
+          MemHandle{hProvider}, params(*params) {
+        if (!KnownSlabs || !LargeAllocs) {
+            throw std::bad_alloc();
+        }
 
         VALGRIND_DO_CREATE_MEMPOOL(this, 0, 0);
 
-        // Generate buckets sized such as: 64, 96, 128, 192, ..., CutOff.
-        // Powers of 2 and the value halfway between the powers of 2.
-        auto Size1 = this->params.MinBucketSize;
-        // MinBucketSize cannot be larger than CutOff.
-        Size1 = std::min(Size1, CutOff);
-        // Buckets sized smaller than the bucket default size- 8 aren't needed.
-        Size1 = std::max(Size1, UMF_DISJOINT_POOL_MIN_BUCKET_DEFAULT_SIZE);
-        // Calculate the exponent for MinBucketSize used for finding buckets.
-        MinBucketSizeExp = (size_t)log2Utils(Size1);
-        auto Size2 = Size1 + Size1 / 2;
-        for (; Size2 < CutOff; Size1 *= 2, Size2 *= 2) {
-            Buckets.push_back(std::make_unique<Bucket>(Size1, *this));
-            Buckets.push_back(std::make_unique<Bucket>(Size2, *this));
+        auto Sizes = makeBucketSizes(this->params);
+        NumShards = std::max(this->params.NumShards, (size_t)1);
+        NumBucketsPerShard = Sizes.size();
+        for (size_t Shard = 0; Shard < NumShards; Shard++) {
+            for (auto Size : Sizes) {
+                Buckets.push_back(std::make_unique<Bucket>(Size, *this));
+            }
+        }
+
+        SizeLUT.resize((log2Utils(CutOff) + 1) << SizeLUTSubBits, 0);
+        for (size_t Key = 0; Key < SizeLUT.size(); Key++) {
+            size_t Exp = Key >> SizeLUTSubBits;
+            if (Exp < SizeLUTSubBits) {
+                continue;
+            }
+            // The smallest size of the range, see sizeToIdx()
+            size_t Lowest = (((size_t)1 << SizeLUTSubBits) |
+                             (Key & (((size_t)1 << SizeLUTSubBits) - 1)))
+                                << (Exp - SizeLUTSubBits);
+            auto It = std::lower_bound(Sizes.begin(), Sizes.end(), Lowest + 1);
+            SizeLUT[Key] = (uint32_t)std::min(It - Sizes.begin(),
+                                              (ptrdiff_t)Sizes.size() - 1);
+        }
+
+        if (this->params.ThreadCacheSize) {
+            for (auto &B : Buckets) {
+                if (B->getSize() > B->ChunkCutOff()) {
+                    break;
+                }
+                NumCachedBuckets++;
+            }
         }
-        Buckets.push_back(std::make_unique<Bucket>(CutOff, *this));
 
         auto ret = umfMemoryProviderGetMinPageSize(hProvider, nullptr,
                                                    &ProviderMinPageSize);
         if (ret != UMF_RESULT_SUCCESS) {
             ProviderMinPageSize = 0;
         }
+
+        // Slabs carved from extents stay aligned to the page size.
+        ExtentSlotSize = this->params.SlabMinSize;
+        if (ProviderMinPageSize) {
+            ExtentSlotSize = AlignUp(ExtentSlotSize, ProviderMinPageSize);
+        }
+        SlotsPerExtent =
+            ExtentSlotSize ? this->params.SlabExtentSize / ExtentSlotSize : 0;
+        if (SlotsPerExtent < 2) {
+            ExtentSlotSize = 0;
+            SlotsPerExtent = 0;
+        }
     }
 
-    ~AllocImpl() { VALGRIND_DO_DESTROY_MEMPOOL(this); }
+    ~AllocImpl();
 
     void *allocate(size_t Size, size_t Alignment, bool &FromPool);
     void *allocate(size_t Size, bool &FromPool);
+    void *allocateZeroed(size_t Size);
+    void *reallocate(void *Ptr, size_t Size);
     void deallocate(void *Ptr, bool &ToPool);
 
+    // Return the number of bytes usable at Ptr, 0 if Ptr is unknown.
+    size_t getUsableSize(void *Ptr);
+
+    uint64_t getPoolId() const { return PoolId; }
+
+    // Return the chunks cached by the given thread cache to the buckets.
+    void flushThreadCache(ThreadCache &Cache);
+
+    // Forget the given thread cache, called when its thread exits.
+    void unregisterThreadCache(ThreadCache &Cache);
+
     umf_memory_provider_handle_t getMemHandle() { return MemHandle; }
 
-    std::shared_timed_mutex &getKnownSlabsMapLock() {
-        return KnownSlabsMapLock;
-    }
-    std::unordered_multimap<void *, Slab &> &getKnownSlabs() {
-        return KnownSlabs;
-    }
+    critnib *getKnownSlabs() { return KnownSlabs.get(); }
 
     size_t SlabMinSize() { return params.SlabMinSize; };
 
+    size_t getProviderMinPageSize() const { return ProviderMinPageSize; }
+
+    // Return all empty slabs kept in the pool to the memory provider.
+    void trim();
+
+    // Find the slab the given pointer belongs to, nullptr if there is none.
+    Slab *findSlab(void *Ptr);
+
     umf_disjoint_pool_params_t &getParams() { return params; }
 
     umf_disjoint_pool_shared_limits_t *getLimits() {
@@ -406,14 +793,214 @@ class DisjointPool::AllocImpl {
         }
     };
 
+    // Allocate/free memory of a slab of Size bytes aligned to Alignment
+    // (0 for the default alignment), carved from an extent if possible.
+    // Extent is set to the extent the memory belongs to and Fresh tells
+    // whether the memory has never been used by a slab.
+    void *allocSlabMemory(size_t Size, size_t Alignment, SlabExtent *&Extent,
+                          bool &Fresh);
+    void freeSlabMemory(void *Ptr, size_t Size, SlabExtent *Extent);
+
+    // Count an allocation/free of Size bytes of the memory provider.
+    void countProviderAlloc(size_t Size) {
+        ProviderAllocCount.fetch_add(1, std::memory_order_relaxed);
+        ProviderBytes.fetch_add(Size, std::memory_order_relaxed);
+    }
+    void countProviderFree(size_t Size) {
+        ProviderFreeCount.fetch_add(1, std::memory_order_relaxed);
+        ProviderBytes.fetch_sub(Size, std::memory_order_relaxed);
+    }
+
+    // Fill in pool statistics and statistics of up to *NumBuckets buckets,
+    // see umfDisjointPoolGetStats().
+    void getStats(umf_disjoint_pool_stats_t *Stats,
+                  umf_disjoint_pool_bucket_stats_t *BucketStats,
+                  size_t *NumBuckets);
+
     void printStats(bool &TitlePrinted, size_t &HighBucketSize,
-                    size_t &HighPeakSlabsInUse, const std::string &Label);
+                    size_t &HighPeakSlabsInUse, const char *Label);
 
   private:
-    Bucket &findBucket(size_t Size);
+    // Find the bucket for the given size, which chunks are also aligned to
+    // the given alignment (as long as the slab is).
+    Bucket &findBucket(size_t Size, size_t Alignment = 1);
     std::size_t sizeToIdx(size_t Size);
+
+    // Return the index of the bucket set used by the calling thread.
+    size_t getShardIdx();
+
+    // Find the bucket for the given size in the set of buckets for the given
+    // alignment (larger than the provider page size), creating the set if
+    // needed. Size must be a multiple of Alignment.
+    Bucket &findAlignedBucket(size_t Size, size_t Alignment);
+
+    // Call F for every bucket of the pool, including the aligned ones.
+    template <typename F> void forEachBucket(F &&Func);
+
+    // Return the cache of the calling thread for this pool, creating it
+    // if needed. Returns nullptr if the per-thread cache is disabled.
+    ThreadCache *getThreadCache();
+    ThreadCache *createThreadCache();
+
+    // Get/return a chunk of the given bucket using the thread cache.
+    void *allocateFromCache(ThreadCache &Cache, Bucket &Bucket, size_t Size,
+                            bool &FromPool);
+    void freeToCache(ThreadCache &Cache, Bucket &Bucket, void *Ptr);
+
+    // Return the 'Count' oldest chunks of the given magazine to the bucket.
+    void flushMagazine(ThreadCache &Cache, size_t Idx, size_t Count);
+
+    // Return the number of bytes usable at Ptr, which belongs to the given
+    // slab or, if Slab is nullptr, was allocated directly from the provider.
+    size_t getUsableSize(void *Ptr, Slab *Slab);
+
+    // Allocate Size bytes aligned to Alignment directly from the memory
+    // provider and record the size of the allocation.
+    void *allocateLarge(size_t Size, size_t Alignment);
+
+    // Return the recorded size of the allocation made directly by the memory
+    // provider at Ptr, 0 if Ptr is not such an allocation of this pool.
+    size_t getLargeSize(void *Ptr) {
+        return reinterpret_cast<size_t>(critnib_get(
+            LargeAllocs.get(), reinterpret_cast<uintptr_t>(Ptr)));
+    }
+
+    // Forget the size of the allocation at Ptr before it is freed.
+    void forgetLargeSize(void *Ptr) {
+        critnib_remove(LargeAllocs.get(), reinterpret_cast<uintptr_t>(Ptr));
+    }
+
+    // Return statistics of buckets, summed over all shards and thread caches.
+    std::vector<umf_disjoint_pool_bucket_stats_t> collectBucketStats();
+
+    // Take an allocation of at least Size bytes aligned to Alignment from
+    // the large allocation cache, nullptr if there is none.
+    void *allocateFromLargeCache(size_t Size, size_t Alignment);
+
+    // Keep the given allocation of Size bytes made directly by the provider
+    // in the large allocation cache. Returns false if it doesn't fit there.
+    bool freeToLargeCache(void *Ptr, size_t Size);
+
+    // Purge and release cached large allocations according to the decay
+    // delays; release all of them if Force is set. LargeCacheLock must be
+    // held.
+    void decayLargeCache(Clock::time_point Now, bool Force);
+
+    // Remove the I-th entry of the large allocation cache and return its
+    // memory to the provider. LargeCacheLock must be held.
+    void releaseLargeCached(size_t I);
+
+    // Return the given entirely free extent to the memory provider.
+    // ExtentsLock must be held.
+    void releaseExtent(SlabExtent *Extent);
+
+    // Add/remove the extent to/from the PartialExtents list.
+    // ExtentsLock must be held.
+    void linkExtent(SlabExtent *Extent);
+    void unlinkExtent(SlabExtent *Extent);
+};
+
+// Per-thread cache of free chunks (a "magazine" per bucket) for buckets used
+// in chunked mode. The owning thread allocates and frees chunks from its
+// magazines without any locking. Magazines are refilled from and flushed to
+// the buckets in batches, so the bucket lock is taken once per batch instead
+// of once per allocation.
+//
+// A thread cache is owned by its thread and deleted only by that thread
+// (when it exits or when it finds out the pool was destroyed). The pool keeps
+// a list of its thread caches to flush them when it is destroyed. Both lists
+// are protected by ThreadCacheRegistryLock.
+class ThreadCache {
+    // The pool which the chunks come from, nullptr after the pool was
+    // destroyed.
+    DisjointPool::AllocImpl *Owner;
+    const uint64_t PoolId;
+
+    // Max number of chunks in a single magazine
+    const size_t Capacity;
+
+    // Number of chunks currently cached in each magazine
+    std::vector<size_t> Counts;
+
+    // Storage of all magazines, 'Capacity' entries per bucket
+    std::vector<void *> Chunks;
+
+    // Allocations and frees served by each magazine
+    std::unique_ptr<BucketCounters[]> Counters;
+
+  public:
+    ThreadCache(DisjointPool::AllocImpl &AllocCtx, size_t NumBuckets,
+                size_t Cap)
+        : Owner(&AllocCtx), PoolId(AllocCtx.getPoolId()), Capacity(Cap),
+          Counts(NumBuckets, 0), Chunks(NumBuckets * Cap, nullptr),
+          Counters(new BucketCounters[NumBuckets]) {}
+
+    DisjointPool::AllocImpl *getOwner() const { return Owner; }
+    void detach() { Owner = nullptr; }
+
+    uint64_t getPoolId() const { return PoolId; }
+    size_t getCapacity() const { return Capacity; }
+    size_t getNumBuckets() const { return Counts.size(); }
+
+    void **getMagazine(size_t Idx) { return &Chunks[Idx * Capacity]; }
+    size_t &getCount(size_t Idx) { return Counts[Idx]; }
+    BucketCounters &getCounters(size_t Idx) { return Counters[Idx]; }
+
+    void *pop(size_t Idx) {
+        size_t &Count = Counts[Idx];
+        return Count ? getMagazine(Idx)[--Count] : nullptr;
+    }
+
+    bool push(size_t Idx, void *Ptr) {
+        size_t &Count = Counts[Idx];
+        if (Count == Capacity) {
+            return false;
+        }
+        getMagazine(Idx)[Count++] = Ptr;
+        return true;
+    }
+};
+
+// Protects the lists of thread caches of all pools and threads.
+static std::mutex ThreadCacheRegistryLock;
+
+// The list of thread caches of the calling thread, one per pool the thread
+// allocated from. The caches are flushed when the thread exits.
+class ThreadCacheList {
+    std::vector<ThreadCache *> Caches;
+
+  public:
+    ~ThreadCacheList();
+
+    ThreadCache *find(uint64_t PoolId) {
+        for (auto *Cache : Caches) {
+            if (Cache->getPoolId() == PoolId) {
+                return Cache;
+            }
+        }
+        return nullptr;
+    }
+
+    // Delete caches of destroyed pools and add the new one.
+    // ThreadCacheRegistryLock must be held.
+    void add(ThreadCache *Cache) {
+        auto It = std::remove_if(Caches.begin(), Caches.end(), [](auto *C) {
+            if (C->getOwner() == nullptr) {
+                delete C;
+                return true;
+            }
+            return false;
+        });
+        Caches.erase(It, Caches.end());
+        Caches.push_back(Cache);
+    }
 };
 
+static thread_local ThreadCacheList LocalThreadCaches;
+
+// The most recently used thread cache of the calling thread.
+static thread_local ThreadCache *LastThreadCache = nullptr;
+
 static void *memoryProviderAlloc(umf_memory_provider_handle_t hProvider,
                                  size_t size, size_t alignment = 0) {
     void *ptr;
@@ -425,14 +1012,15 @@ static void *memoryProviderAlloc(umf_memory_provider_handle_t hProvider,
     return ptr;
 }
 
-static void memoryProviderFree(umf_memory_provider_handle_t hProvider,
-                               void *ptr) {
-    size_t size = 0;
-
-    if (ptr) {
-        umf_alloc_info_t allocInfo = {NULL, 0, NULL};
+// Returns the size of the freed allocation, 0 if it is unknown.
+// If size is 0, it is looked up in the memory tracker.
+static size_t memoryProviderFree(umf_memory_provider_handle_t hProvider,
+                                 void *ptr, size_t size = 0) {
+    if (ptr && !size) {
+        umf_alloc_info_t allocInfo = {NULL, 0, NULL, false};
         umf_result_t umf_result = umfMemoryTrackerGetAllocInfo(ptr, &allocInfo);
-        if (umf_result == UMF_RESULT_SUCCESS) {
+        // with coarse tracking, only the size of the extent is known
+        if (umf_result == UMF_RESULT_SUCCESS && !allocInfo.coarse) {
             size = allocInfo.baseSize;
         }
     }
@@ -441,37 +1029,78 @@ static void memoryProviderFree(umf_memory_provider_handle_t hProvider,
     if (ret != UMF_RESULT_SUCCESS) {
         throw MemoryProviderError{ret};
     }
+
+    return size;
+}
+
+// A tracking provider with coarse tracking carves allocations from its extents
+// and reuses their space without returning it to the memory provider, so such
+// memory is not known to be zeroed even if the provider zeroes new memory.
+static bool isCoarselyTracked(void *ptr) {
+    umf_alloc_info_t allocInfo = {NULL, 0, NULL, false};
+    return umfMemoryTrackerGetAllocInfo(ptr, &allocInfo) ==
+               UMF_RESULT_SUCCESS &&
+           allocInfo.coarse;
 }
 
 bool operator==(const Slab &Lhs, const Slab &Rhs) {
     return Lhs.getPtr() == Rhs.getPtr();
 }
 
-std::ostream &operator<<(std::ostream &Os, const Slab &Slab) {
-    Os << "Slab<" << Slab.getPtr() << ", " << Slab.getEnd() << ", "
-       << Slab.getBucket().getSize() << ">";
-    return Os;
+Slab *Slab::create(Bucket &Bkt) {
+    // In case bucket size is not a multiple of SlabMinSize, we would have
+    // some padding at the end of the slab.
+    size_t NumChunks = Bkt.SlabMinSize() / Bkt.getSize();
+
+    void *Storage = umf_ba_global_alloc(
+        sizeof(Slab) + NumBitmapWords(NumChunks) * sizeof(uint64_t));
+    if (!Storage) {
+        throw MemoryProviderError{UMF_RESULT_ERROR_OUT_OF_HOST_MEMORY};
+    }
+
+    try {
+        return new (Storage) Slab(Bkt, NumChunks);
+    } catch (...) {
+        umf_ba_global_free(Storage);
+        throw;
+    }
 }
 
-Slab::Slab(Bucket &Bkt)
-    : // In case bucket size is not a multiple of SlabMinSize, we would have
-      // some padding at the end of the slab.
-      Chunks(Bkt.SlabMinSize() / Bkt.getSize()), NumAllocated{0},
-      bucket(Bkt), SlabListIter{}, FirstFreeChunkIdx{0} {
-    auto SlabSize = Bkt.SlabAllocSize();
-    MemPtr = memoryProviderAlloc(Bkt.getMemHandle(), SlabSize);
-    regSlab(*this);
+void Slab::destroy(Slab *S) {
+    S->~Slab();
+    umf_ba_global_free(S);
 }
 
-Slab::~Slab() {
+Slab::Slab(Bucket &Bkt, size_t NumChunks)
+    : NumChunks(NumChunks), NumAllocated{0}, bucket(Bkt),
+      FirstFreeWordIdx{0} {
+    // Mark all chunks as free, bits past the last chunk stay clear.
+    auto *Bitmap = getBitmap();
+    size_t NumWords = NumBitmapWords(NumChunks);
+    for (size_t I = 0; I < NumWords; I++) {
+        Bitmap[I] = ~uint64_t(0);
+    }
+    if (NumChunks % 64) {
+        Bitmap[NumWords - 1] = (uint64_t(1) << (NumChunks % 64)) - 1;
+    }
+
+    auto SlabSize = Bkt.SlabAllocSize();
+    MemPtr = Bkt.getAllocCtx().allocSlabMemory(
+        SlabSize, Bkt.getSlabAlignment(), Extent, FreshMemory);
     try {
-        unregSlab(*this);
-    } catch (std::exception &e) {
-        LOG_ERR("DisjointPool: unexpected error: %s", e.what());
+        regSlab();
+    } catch (...) {
+        Bkt.getAllocCtx().freeSlabMemory(MemPtr, SlabSize, Extent);
+        throw;
     }
+}
+
+Slab::~Slab() {
+    unregSlab();
 
     try {
-        memoryProviderFree(bucket.getMemHandle(), MemPtr);
+        bucket.getAllocCtx().freeSlabMemory(MemPtr, bucket.SlabAllocSize(),
+                                            Extent);
     } catch (MemoryProviderError &e) {
         LOG_ERR("DisjointPool: error from memory provider: %d", e.code);
 
@@ -493,18 +1122,20 @@ Slab::~Slab() {
 
 // Return the index of the first available chunk, SIZE_MAX otherwise
 size_t Slab::FindFirstAvailableChunkIdx() const {
-    // Use the first free chunk index as a hint for the search.
-    auto It = std::find_if(Chunks.begin() + FirstFreeChunkIdx, Chunks.end(),
-                           [](auto x) { return !x; });
-    if (It != Chunks.end()) {
-        return It - Chunks.begin();
+    // Use the first free word index as a hint for the search.
+    const auto *Bitmap = getBitmap();
+    size_t NumWords = NumBitmapWords(NumChunks);
+    for (size_t I = FirstFreeWordIdx; I < NumWords; I++) {
+        if (Bitmap[I]) {
+            return I * 64 + utils_lssb_index(Bitmap[I]);
+        }
     }
 
     return std::numeric_limits<size_t>::max();
 }
 
 void *Slab::getChunk() {
-    // assert(NumAllocated != Chunks.size());
+    // assert(NumAllocated != NumChunks);
 
     const size_t ChunkIdx = FindFirstAvailableChunkIdx();
     // Free chunk must exist, otherwise we would have allocated another slab
@@ -512,64 +1143,75 @@ void *Slab::getChunk() {
 
     void *const FreeChunk =
         (static_cast<uint8_t *>(getPtr())) + ChunkIdx * getChunkSize();
-    Chunks[ChunkIdx] = true;
+    getBitmap()[ChunkIdx / 64] &= ~(uint64_t(1) << (ChunkIdx % 64));
     NumAllocated += 1;
 
-    // Use the found index as the next hint
-    FirstFreeChunkIdx = ChunkIdx;
+    // Use the found word as the next hint
+    FirstFreeWordIdx = ChunkIdx / 64;
 
     return FreeChunk;
 }
 
 void *Slab::getSlab() { return getPtr(); }
 
-Bucket &Slab::getBucket() { return bucket; }
-const Bucket &Slab::getBucket() const { return bucket; }
+void Slab::purge() {
+    assert(NumAllocated == 0);
 
-size_t Slab::getChunkSize() const { return bucket.getSize(); }
+    // Only whole pages can be purged.
+    void *Ptr = MemPtr;
+    size_t Size = bucket.SlabAllocSize();
+    size_t PageSize = bucket.getAllocCtx().getProviderMinPageSize();
+    if (PageSize) {
+        utils_align_ptr_up_size_down(&Ptr, &Size, PageSize);
+    }
 
-void Slab::regSlabByAddr(void *Addr, Slab &Slab) {
-    auto &Lock = Slab.getBucket().getAllocCtx().getKnownSlabsMapLock();
-    auto &Map = Slab.getBucket().getAllocCtx().getKnownSlabs();
+    if (Size) {
+        auto ret = umfMemoryProviderPurgeLazy(bucket.getMemHandle(), Ptr, Size);
+        if (ret != UMF_RESULT_SUCCESS) {
+            LOG_DEBUG("DisjointPool: purging a slab failed: %d", ret);
+        }
+    }
 
-    std::lock_guard<std::shared_timed_mutex> Lg(Lock);
-    Map.insert({Addr, Slab});
+    // Do not retry if purging is not supported.
+    Purged = true;
 }
 
-void Slab::unregSlabByAddr(void *Addr, Slab &Slab) {
-    auto &Lock = Slab.getBucket().getAllocCtx().getKnownSlabsMapLock();
-    auto &Map = Slab.getBucket().getAllocCtx().getKnownSlabs();
-
-    std::lock_guard<std::shared_timed_mutex> Lg(Lock);
+Bucket &Slab::getBucket() { return bucket; }
+const Bucket &Slab::getBucket() const { return bucket; }
 
-    auto Slabs = Map.equal_range(Addr);
-    // At least the must get the current slab from the map.
-    assert(Slabs.first != Slabs.second && "Slab is not found");
+size_t Slab::getChunkSize() const { return bucket.getSize(); }
 
-    for (auto It = Slabs.first; It != Slabs.second; ++It) {
-        if (It->second == Slab) {
-            Map.erase(It);
-            return;
-        }
+// The slab is registered under its first byte and under its last byte, the
+// latter with SlabEndTag set in the value. This way the closest key not
+// greater than a pointer tells, without touching any slab, whether the pointer
+// is inside of a slab: slabs never overlap, so a pointer belongs to a slab
+// only if the key found is the slab's start or the slab's last byte itself.
+// The end key is inserted first and removed last, so a lookup never finds the
+// start key of a slab without its end key.
+void Slab::regSlab() {
+    auto *Index = bucket.getAllocCtx().getKnownSlabs();
+    auto Start = reinterpret_cast<uintptr_t>(getPtr());
+    auto Last = reinterpret_cast<uintptr_t>(getEnd()) - 1;
+    auto *Value = reinterpret_cast<void *>(reinterpret_cast<uintptr_t>(this) |
+                                           SlabEndTag);
+
+    if (critnib_insert(Index, Last, Value, 0) != 0) {
+        throw MemoryProviderError{UMF_RESULT_ERROR_OUT_OF_HOST_MEMORY};
     }
 
-    assert(false && "Slab is not found");
-}
-
-void Slab::regSlab(Slab &Slab) {
-    void *StartAddr = AlignPtrDown(Slab.getPtr(), bucket.SlabMinSize());
-    void *EndAddr = static_cast<char *>(StartAddr) + bucket.SlabMinSize();
-
-    regSlabByAddr(StartAddr, Slab);
-    regSlabByAddr(EndAddr, Slab);
+    if (critnib_insert(Index, Start, this, 0) != 0) {
+        critnib_remove(Index, Last);
+        throw MemoryProviderError{UMF_RESULT_ERROR_OUT_OF_HOST_MEMORY};
+    }
 }
 
-void Slab::unregSlab(Slab &Slab) {
-    void *StartAddr = AlignPtrDown(Slab.getPtr(), bucket.SlabMinSize());
-    void *EndAddr = static_cast<char *>(StartAddr) + bucket.SlabMinSize();
+void Slab::unregSlab() {
+    auto *Index = bucket.getAllocCtx().getKnownSlabs();
 
-    unregSlabByAddr(StartAddr, Slab);
-    unregSlabByAddr(EndAddr, Slab);
+    [[maybe_unused]] void *Removed =
+        critnib_remove(Index, reinterpret_cast<uintptr_t>(getPtr()));
+    assert(Removed == this && "Slab is not found");
+    critnib_remove(Index, reinterpret_cast<uintptr_t>(getEnd()) - 1);
 }
 
 void Slab::freeChunk(void *Ptr) {
@@ -584,19 +1226,28 @@ void Slab::freeChunk(void *Ptr) {
     auto ChunkIdx = (static_cast<char *>(Ptr) - static_cast<char *>(MemPtr)) /
                     getChunkSize();
 
+    auto &Word = getBitmap()[ChunkIdx / 64];
+    const uint64_t Bit = uint64_t(1) << (ChunkIdx % 64);
+
     // Make sure that the chunk was allocated
-    assert(Chunks[ChunkIdx] && "double free detected");
+    assert(!(Word & Bit) && "double free detected");
 
-    Chunks[ChunkIdx] = false;
+    Word |= Bit;
     NumAllocated -= 1;
 
-    if (ChunkIdx < FirstFreeChunkIdx) {
-        FirstFreeChunkIdx = ChunkIdx;
+    if (ChunkIdx / 64 < FirstFreeWordIdx) {
+        FirstFreeWordIdx = ChunkIdx / 64;
     }
 }
 
+void *Slab::getChunkStart(void *Ptr) const {
+    auto ChunkIdx = (static_cast<char *>(Ptr) - static_cast<char *>(MemPtr)) /
+                    getChunkSize();
+    return static_cast<char *>(MemPtr) + ChunkIdx * getChunkSize();
+}
+
 void *Slab::getEnd() const {
-    return static_cast<char *>(getPtr()) + bucket.SlabMinSize();
+    return static_cast<char *>(getPtr()) + bucket.SlabAllocSize();
 }
 
 bool Slab::hasAvail() { return NumAllocated != getNumChunks(); }
@@ -609,59 +1260,58 @@ void Bucket::decrementPool(bool &FromPool) {
     OwnAllocCtx.getLimits()->TotalSize -= SlabAllocSize();
 }
 
-auto Bucket::getAvailFullSlab(bool &FromPool)
-    -> decltype(AvailableSlabs.begin()) {
+Bucket::~Bucket() {
+    for (auto *List : {&AvailableSlabs, &UnavailableSlabs}) {
+        while (auto *S = List->front()) {
+            List->remove(*S);
+            Slab::destroy(S);
+        }
+    }
+}
+
+Slab *Bucket::getAvailFullSlab(bool &FromPool) {
     // Return a slab that will be used for a single allocation.
-    if (AvailableSlabs.size() == 0) {
-        auto It = AvailableSlabs.insert(AvailableSlabs.begin(),
-                                        std::make_unique<Slab>(*this));
-        (*It)->setIterator(It);
+    if (AvailableSlabs.empty()) {
+        AvailableSlabs.pushFront(*Slab::create(*this));
         FromPool = false;
         updateStats(1, 0);
     } else {
         decrementPool(FromPool);
     }
 
-    return AvailableSlabs.begin();
+    return AvailableSlabs.front();
 }
 
 void *Bucket::getSlab(bool &FromPool) {
     std::lock_guard<std::mutex> Lg(BucketLock);
 
-    auto SlabIt = getAvailFullSlab(FromPool);
-    auto *FreeSlab = (*SlabIt)->getSlab();
-    auto It =
-        UnavailableSlabs.insert(UnavailableSlabs.begin(), std::move(*SlabIt));
-    AvailableSlabs.erase(SlabIt);
-    (*It)->setIterator(It);
+    auto *FullSlab = getAvailFullSlab(FromPool);
+    auto *FreeSlab = FullSlab->getSlab();
+    AvailableSlabs.remove(*FullSlab);
+    UnavailableSlabs.pushFront(*FullSlab);
     return FreeSlab;
 }
 
 void Bucket::freeSlab(Slab &Slab, bool &ToPool) {
     std::lock_guard<std::mutex> Lg(BucketLock);
-    auto SlabIter = Slab.getIterator();
-    assert(SlabIter != UnavailableSlabs.end());
+    UnavailableSlabs.remove(Slab);
     if (CanPool(ToPool)) {
-        auto It =
-            AvailableSlabs.insert(AvailableSlabs.begin(), std::move(*SlabIter));
-        UnavailableSlabs.erase(SlabIter);
-        (*It)->setIterator(It);
+        AvailableSlabs.pushFront(Slab);
+        onPoolSlab(Slab);
     } else {
-        UnavailableSlabs.erase(SlabIter);
+        Slab::destroy(&Slab);
     }
 }
 
-auto Bucket::getAvailSlab(bool &FromPool) -> decltype(AvailableSlabs.begin()) {
+Slab *Bucket::getAvailSlab(bool &FromPool) {
 
-    if (AvailableSlabs.size() == 0) {
-        auto It = AvailableSlabs.insert(AvailableSlabs.begin(),
-                                        std::make_unique<Slab>(*this));
-        (*It)->setIterator(It);
+    if (AvailableSlabs.empty()) {
+        AvailableSlabs.pushFront(*Slab::create(*this));
 
         updateStats(1, 0);
         FromPool = false;
     } else {
-        if ((*(AvailableSlabs.begin()))->getNumAllocated() == 0) {
+        if (AvailableSlabs.front()->getNumAllocated() == 0) {
             // If this was an empty slab, it was in the pool.
             // Now it is no longer in the pool, so update count.
             --chunkedSlabsInPool;
@@ -672,34 +1322,78 @@ auto Bucket::getAvailSlab(bool &FromPool) -> decltype(AvailableSlabs.begin()) {
         }
     }
 
-    return AvailableSlabs.begin();
+    return AvailableSlabs.front();
 }
 
 void *Bucket::getChunk(bool &FromPool) {
     std::lock_guard<std::mutex> Lg(BucketLock);
+    drainRemoteFrees();
+    return getChunkLocked(FromPool);
+}
+
+size_t Bucket::getChunks(void **Chunks, size_t Count, bool &FromPool) {
+    std::lock_guard<std::mutex> Lg(BucketLock);
+    drainRemoteFrees();
+
+    size_t Got = 0;
+    try {
+        for (; Got < Count; Got++) {
+            Chunks[Got] = getChunkLocked(FromPool);
+        }
+    } catch (MemoryProviderError &) {
+        // Out of memory is reported only if no chunk could be taken.
+        if (Got == 0) {
+            throw;
+        }
+    }
+
+    return Got;
+}
 
-    auto SlabIt = getAvailSlab(FromPool);
-    auto *FreeChunk = (*SlabIt)->getChunk();
+void *Bucket::getChunkLocked(bool &FromPool) {
+    auto *AvailSlab = getAvailSlab(FromPool);
+    auto *FreeChunk = AvailSlab->getChunk();
 
-    // If the slab is full, move it to unavailable slabs and update its iterator
-    if (!((*SlabIt)->hasAvail())) {
-        auto It = UnavailableSlabs.insert(UnavailableSlabs.begin(),
-                                          std::move(*SlabIt));
-        AvailableSlabs.erase(SlabIt);
-        (*It)->setIterator(It);
+    // If the slab is full, move it to unavailable slabs
+    if (!AvailSlab->hasAvail()) {
+        AvailableSlabs.remove(*AvailSlab);
+        UnavailableSlabs.pushFront(*AvailSlab);
     }
 
     return FreeChunk;
 }
 
 void Bucket::freeChunk(void *Ptr, Slab &Slab, bool &ToPool) {
-    std::lock_guard<std::mutex> Lg(BucketLock);
+    // Don't wait for the lock if another thread holds it, e.g. when chunks
+    // allocated by one thread are freed by another. The chunk will be freed
+    // by the thread which takes the lock next.
+    std::unique_lock<std::mutex> Lk(BucketLock, std::try_to_lock);
+    if (!Lk.owns_lock()) {
+        if (pushRemoteFree(Slab.getChunkStart(Ptr))) {
+            ToPool = true;
+            return;
+        }
+        Lk.lock();
+    }
+
+    drainRemoteFrees();
 
     Slab.freeChunk(Ptr);
 
     onFreeChunk(Slab, ToPool);
 }
 
+void Bucket::freeChunks(void **Ptrs, Slab **Slabs, size_t Count) {
+    std::lock_guard<std::mutex> Lg(BucketLock);
+    drainRemoteFrees();
+
+    for (size_t i = 0; i < Count; i++) {
+        bool ToPool;
+        Slabs[i]->freeChunk(Ptrs[i]);
+        onFreeChunk(*Slabs[i], ToPool);
+    }
+}
+
 // The lock must be acquired before calling this method
 void Bucket::onFreeChunk(Slab &Slab, bool &ToPool) {
     ToPool = true;
@@ -707,14 +1401,8 @@ void Bucket::onFreeChunk(Slab &Slab, bool &ToPool) {
     // In case if the slab was previously full and now has 1 available
     // chunk, it should be moved to the list of available slabs
     if (Slab.getNumAllocated() == (Slab.getNumChunks() - 1)) {
-        auto SlabIter = Slab.getIterator();
-        assert(SlabIter != UnavailableSlabs.end());
-
-        auto It =
-            AvailableSlabs.insert(AvailableSlabs.begin(), std::move(*SlabIter));
-        UnavailableSlabs.erase(SlabIter);
-
-        (*It)->setIterator(It);
+        UnavailableSlabs.remove(Slab);
+        AvailableSlabs.pushFront(Slab);
     }
 
     // Check if slab is empty, and pool it if we can.
@@ -724,37 +1412,150 @@ void Bucket::onFreeChunk(Slab &Slab, bool &ToPool) {
         // The ToPool parameter indicates whether the Slab will be put in the
         // pool or freed.
         if (!CanPool(ToPool)) {
-            // Note: since the slab is stored as unique_ptr, just remove it from
-            // the list to destroy the object.
-            auto It = Slab.getIterator();
-            assert(It != AvailableSlabs.end());
-            AvailableSlabs.erase(It);
+            AvailableSlabs.remove(Slab);
+            Slab::destroy(&Slab);
+        } else {
+            onPoolSlab(Slab);
         }
     }
 }
 
-bool Bucket::CanPool(bool &ToPool) {
-    size_t NewFreeSlabsInBucket;
-    // Check if this bucket is used in chunked form or as full slabs.
-    bool chunkedBucket = getSize() <= ChunkCutOff();
-    if (chunkedBucket) {
-        NewFreeSlabsInBucket = chunkedSlabsInPool + 1;
-    } else {
-        NewFreeSlabsInBucket = AvailableSlabs.size() + 1;
+bool Bucket::pushRemoteFree(void *Chunk) {
+    for (auto &Slot : RemoteFrees) {
+        void *Empty = nullptr;
+        if (!Slot.load(std::memory_order_relaxed) &&
+            Slot.compare_exchange_strong(Empty, Chunk,
+                                         std::memory_order_relaxed)) {
+            // A read-modify-write, so that the drain which observes the flag
+            // also observes the slots filled by all the preceding pushes.
+            HasRemoteFrees.exchange(true, std::memory_order_acq_rel);
+            return true;
+        }
     }
-    if (Capacity() >= NewFreeSlabsInBucket) {
-        size_t PoolSize = OwnAllocCtx.getLimits()->TotalSize;
-        while (true) {
-            size_t NewPoolSize = PoolSize + SlabAllocSize();
 
-            if (OwnAllocCtx.getLimits()->MaxSize < NewPoolSize) {
-                break;
-            }
+    return false;
+}
 
-            if (OwnAllocCtx.getLimits()->TotalSize.compare_exchange_strong(
-                    PoolSize, NewPoolSize)) {
-                if (chunkedBucket) {
-                    ++chunkedSlabsInPool;
+void Bucket::drainRemoteFrees() {
+    if (!HasRemoteFrees.load(std::memory_order_relaxed) ||
+        !HasRemoteFrees.exchange(false, std::memory_order_acq_rel)) {
+        return;
+    }
+
+    // Chunks pushed from now on set the flag again.
+    for (auto &Slot : RemoteFrees) {
+        if (!Slot.load(std::memory_order_relaxed)) {
+            continue;
+        }
+        void *Chunk = Slot.exchange(nullptr, std::memory_order_relaxed);
+        if (!Chunk) {
+            continue;
+        }
+
+        auto *Slab = OwnAllocCtx.findSlab(Chunk);
+        assert(Slab && "remotely freed chunk does not belong to any slab");
+        bool ToPool;
+        Slab->freeChunk(Chunk);
+        onFreeChunk(*Slab, ToPool);
+    }
+}
+
+void Bucket::onPoolSlab(Slab &Slab) {
+    auto &Params = OwnAllocCtx.getParams();
+    if (!Params.PurgeDelayMs && !Params.ReleaseDelayMs) {
+        return;
+    }
+
+    auto Now = Clock::now();
+    Slab.setPooled(Now);
+
+    // The shorter of the enabled delays
+    size_t DelayMs = Params.PurgeDelayMs;
+    if (!DelayMs ||
+        (Params.ReleaseDelayMs && Params.ReleaseDelayMs < DelayMs)) {
+        DelayMs = Params.ReleaseDelayMs;
+    }
+    auto Delay = std::chrono::milliseconds(DelayMs);
+    NextDecayTime = std::min(NextDecayTime, Now + Delay);
+
+    decay(Now, false);
+}
+
+void Bucket::decay(Clock::time_point Now, bool Force) {
+    if (!Force && Now < NextDecayTime) {
+        return;
+    }
+
+    auto &Params = OwnAllocCtx.getParams();
+    auto PurgeDelay = std::chrono::milliseconds(Params.PurgeDelayMs);
+    auto ReleaseDelay = std::chrono::milliseconds(Params.ReleaseDelayMs);
+    bool ChunkedBucket = getSize() <= ChunkCutOff();
+
+    NextDecayTime = Clock::time_point::max();
+    for (auto *Next = AvailableSlabs.front(); Next;) {
+        auto &Slab = *Next;
+        Next = Slab.getNext();
+        // Only entirely free slabs are in the pool.
+        if (Slab.getNumAllocated() != 0) {
+            continue;
+        }
+
+        auto PooledTime = Slab.getPooledTime();
+        if (Force ||
+            (Params.ReleaseDelayMs && Now >= PooledTime + ReleaseDelay)) {
+            if (ChunkedBucket) {
+                --chunkedSlabsInPool;
+            }
+            updateStats(0, -1);
+            OwnAllocCtx.getLimits()->TotalSize -= SlabAllocSize();
+            AvailableSlabs.remove(Slab);
+            Slab::destroy(&Slab);
+            continue;
+        }
+
+        if (Params.PurgeDelayMs && !Slab.isPurged()) {
+            if (Now >= PooledTime + PurgeDelay) {
+                Slab.purge();
+            } else {
+                NextDecayTime =
+                    std::min(NextDecayTime, PooledTime + PurgeDelay);
+            }
+        }
+
+        if (Params.ReleaseDelayMs) {
+            NextDecayTime = std::min(NextDecayTime, PooledTime + ReleaseDelay);
+        }
+    }
+}
+
+void Bucket::trim() {
+    std::lock_guard<std::mutex> Lg(BucketLock);
+    drainRemoteFrees();
+    decay(Clock::now(), true);
+}
+
+bool Bucket::CanPool(bool &ToPool) {
+    size_t NewFreeSlabsInBucket;
+    // Check if this bucket is used in chunked form or as full slabs.
+    bool chunkedBucket = getSize() <= ChunkCutOff();
+    if (chunkedBucket) {
+        NewFreeSlabsInBucket = chunkedSlabsInPool + 1;
+    } else {
+        NewFreeSlabsInBucket = AvailableSlabs.size() + 1;
+    }
+    if (Capacity() >= NewFreeSlabsInBucket) {
+        size_t PoolSize = OwnAllocCtx.getLimits()->TotalSize;
+        while (true) {
+            size_t NewPoolSize = PoolSize + SlabAllocSize();
+
+            if (OwnAllocCtx.getLimits()->MaxSize < NewPoolSize) {
+                break;
+            }
+
+            if (OwnAllocCtx.getLimits()->TotalSize.compare_exchange_strong(
+                    PoolSize, NewPoolSize)) {
+                if (chunkedBucket) {
+                    ++chunkedSlabsInPool;
                 }
 
                 updateStats(-1, 1);
@@ -793,44 +1594,35 @@ size_t Bucket::MaxPoolableSize() {
 
 size_t Bucket::ChunkCutOff() { return SlabMinSize() / 2; }
 
-void Bucket::countAlloc(bool FromPool) {
-    ++allocCount;
-    if (FromPool) {
-        ++allocPoolCount;
+// Add Delta to Current and raise Max if needed. Both are written only under
+// the bucket lock.
+static void updateSlabCount(std::atomic<size_t> &Current,
+                            std::atomic<size_t> &Max, int Delta) {
+    size_t Value = Current.load(std::memory_order_relaxed) + Delta;
+    Current.store(Value, std::memory_order_relaxed);
+    if (Value > Max.load(std::memory_order_relaxed)) {
+        Max.store(Value, std::memory_order_relaxed);
     }
 }
 
-void Bucket::countFree() { ++freeCount; }
-
 void Bucket::updateStats(int InUse, int InPool) {
+    updateSlabCount(currSlabsInUse, maxSlabsInUse, InUse);
+    updateSlabCount(currSlabsInPool, maxSlabsInPool, InPool);
+
     if (OwnAllocCtx.getParams().PoolTrace == 0) {
         return;
     }
-    currSlabsInUse += InUse;
-    maxSlabsInUse = std::max(currSlabsInUse, maxSlabsInUse);
-    currSlabsInPool += InPool;
-    maxSlabsInPool = std::max(currSlabsInPool, maxSlabsInPool);
     // Increment or decrement current pool sizes based on whether
     // slab was added to or removed from pool.
     OwnAllocCtx.getParams().CurPoolSize += InPool * SlabAllocSize();
 }
 
-void Bucket::printStats(bool &TitlePrinted, const std::string &Label) {
-    if (allocCount) {
-        if (!TitlePrinted) {
-            std::cout << Label << " memory statistics\n";
-            std::cout << std::setw(14) << "Bucket Size" << std::setw(12)
-                      << "Allocs" << std::setw(12) << "Frees" << std::setw(18)
-                      << "Allocs from Pool" << std::setw(20)
-                      << "Peak Slabs in Use" << std::setw(21)
-                      << "Peak Slabs in Pool" << std::endl;
-            TitlePrinted = true;
-        }
-        std::cout << std::setw(14) << getSize() << std::setw(12) << allocCount
-                  << std::setw(12) << freeCount << std::setw(18)
-                  << allocPoolCount << std::setw(20) << maxSlabsInUse
-                  << std::setw(21) << maxSlabsInPool << std::endl;
-    }
+void Bucket::addStats(umf_disjoint_pool_bucket_stats_t &Stats) const {
+    Counters.addTo(Stats);
+    Stats.SlabsInUse += currSlabsInUse.load(std::memory_order_relaxed);
+    Stats.MaxSlabsInUse += maxSlabsInUse.load(std::memory_order_relaxed);
+    Stats.SlabsInPool += currSlabsInPool.load(std::memory_order_relaxed);
+    Stats.MaxSlabsInPool += maxSlabsInPool.load(std::memory_order_relaxed);
 }
 
 void *DisjointPool::AllocImpl::allocate(size_t Size, bool &FromPool) try {
@@ -842,21 +1634,27 @@ void *DisjointPool::AllocImpl::allocate(size_t Size, bool &FromPool) try {
 
     FromPool = false;
     if (Size > getParams().MaxPoolableSize) {
-        Ptr = memoryProviderAlloc(getMemHandle(), Size);
+        Ptr = allocateFromLargeCache(Size, 0);
+        if (Ptr) {
+            FromPool = true;
+        } else {
+            Ptr = allocateLarge(Size, 0);
+        }
+        LargeCounters.countAlloc(Size, FromPool);
         annotate_memory_undefined(Ptr, Size);
         return Ptr;
     }
 
     auto &Bucket = findBucket(Size);
 
-    if (Size > Bucket.ChunkCutOff()) {
+    if (Bucket.getSize() > Bucket.ChunkCutOff()) {
         Ptr = Bucket.getSlab(FromPool);
+        Bucket.Counters.countAlloc(Size, FromPool);
+    } else if (auto *Cache = getThreadCache()) {
+        Ptr = allocateFromCache(*Cache, Bucket, Size, FromPool);
     } else {
         Ptr = Bucket.getChunk(FromPool);
-    }
-
-    if (getParams().PoolTrace > 1) {
-        Bucket.countAlloc(FromPool);
+        Bucket.Counters.countAlloc(Size, FromPool);
     }
 
     VALGRIND_DO_MEMPOOL_ALLOC(this, Ptr, Size);
@@ -880,38 +1678,56 @@ void *DisjointPool::AllocImpl::allocate(size_t Size, size_t Alignment,
         return allocate(Size, FromPool);
     }
 
-    size_t AlignedSize;
-    if (Alignment <= ProviderMinPageSize) {
-        // This allocation will be served from a Bucket which size is multiple
-        // of Alignment and Slab address is aligned to ProviderMinPageSize
-        // so the address will be properly aligned.
-        AlignedSize = (Size > 1) ? AlignUp(Size, Alignment) : Alignment;
-    } else {
-        // Slabs are only aligned to ProviderMinPageSize, we need to compensate
-        // for that in case the allocation is within pooling limit.
-        // TODO: consider creating properly-aligned Slabs on demand
-        AlignedSize = Size + Alignment - 1;
-    }
+    size_t AlignedSize = (Size > 1) ? AlignUp(Size, Alignment) : Alignment;
 
     // Check if requested allocation size is within pooling limit.
     // If not, just request aligned pointer from the system.
     FromPool = false;
     if (AlignedSize > getParams().MaxPoolableSize) {
-        Ptr = memoryProviderAlloc(getMemHandle(), Size, Alignment);
+        Ptr = allocateFromLargeCache(Size, Alignment);
+        if (Ptr) {
+            FromPool = true;
+        } else {
+            Ptr = allocateLarge(Size, Alignment);
+        }
+        LargeCounters.countAlloc(Size, FromPool);
         annotate_memory_undefined(Ptr, Size);
         return Ptr;
     }
 
-    auto &Bucket = findBucket(AlignedSize);
+    Bucket *BucketPtr;
+    if (Alignment <= ProviderMinPageSize) {
+        // This allocation will be served from a Bucket which size is multiple
+        // of Alignment and Slab address is aligned to ProviderMinPageSize
+        // so the address will be properly aligned.
+        BucketPtr = &findBucket(AlignedSize, Alignment);
+    } else {
+        // Slabs of default buckets are only aligned to ProviderMinPageSize,
+        // so either use a bucket which slabs are allocated aligned or pad the
+        // allocation, whichever takes less memory.
+        BucketPtr = &findAlignedBucket(AlignedSize, Alignment);
+        size_t PaddedSize = Size + Alignment - 1;
+        if (PaddedSize <= getParams().MaxPoolableSize) {
+            auto &Padded = findBucket(PaddedSize);
+            if (Padded.getSize() < BucketPtr->getSize()) {
+                BucketPtr = &Padded;
+            }
+        }
+    }
+    auto &Bucket = *BucketPtr;
 
-    if (AlignedSize > Bucket.ChunkCutOff()) {
+    if (Bucket.getSize() > Bucket.ChunkCutOff()) {
         Ptr = Bucket.getSlab(FromPool);
+        Bucket.Counters.countAlloc(Size, FromPool);
+    } else if (Bucket.getSlabAlignment()) {
+        // Thread caches hold chunks of the default bucket sets only.
+        Ptr = Bucket.getChunk(FromPool);
+        Bucket.Counters.countAlloc(Size, FromPool);
+    } else if (auto *Cache = getThreadCache()) {
+        Ptr = allocateFromCache(*Cache, Bucket, Size, FromPool);
     } else {
         Ptr = Bucket.getChunk(FromPool);
-    }
-
-    if (getParams().PoolTrace > 1) {
-        Bucket.countAlloc(FromPool);
+        Bucket.Counters.countAlloc(Size, FromPool);
     }
 
     VALGRIND_DO_MEMPOOL_ALLOC(this, AlignPtrUp(Ptr, Alignment), Size);
@@ -922,96 +1738,853 @@ void *DisjointPool::AllocImpl::allocate(size_t Size, size_t Alignment,
     return nullptr;
 }
 
+void *DisjointPool::AllocImpl::allocateZeroed(size_t Size) {
+    bool FromPool;
+    void *Ptr = allocate(Size, FromPool);
+    if (!Ptr) {
+        return nullptr;
+    }
+
+    // Full slabs and allocations above the pooling limit that were not taken
+    // from the pool come straight from the provider. Chunks always have to
+    // be cleared, since other chunks of their slab might have been used,
+    // and so do new slabs carved from extent slots used by earlier slabs
+    // and memory carved from extents of a coarsely tracking provider.
+    bool Fresh = !FromPool;
+    if (Fresh && Size <= getParams().MaxPoolableSize) {
+        auto &Bucket = findBucket(Size);
+        Fresh = Bucket.getSize() > Bucket.ChunkCutOff() &&
+                findSlab(Ptr)->hasFreshMemory();
+    }
+    if (!(Fresh && getParams().ProviderMemoryZeroed &&
+          !isCoarselyTracked(Ptr))) {
+        std::memset(Ptr, 0, Size);
+    }
+
+    return Ptr;
+}
+
+void *DisjointPool::AllocImpl::reallocate(void *Ptr, size_t Size) {
+    bool FromPool, ToPool;
+
+    if (!Ptr) {
+        return allocate(Size, FromPool);
+    }
+
+    if (Size == 0) {
+        deallocate(Ptr, ToPool);
+        return nullptr;
+    }
+
+    auto *Slab = findSlab(Ptr);
+    size_t UsableSize = getUsableSize(Ptr, Slab);
+    if (!UsableSize) {
+        // The content could not be copied.
+        LOG_ERR("DisjointPool: realloc of unknown pointer %p", Ptr);
+        umf::getPoolLastStatusRef<DisjointPool>() =
+            UMF_RESULT_ERROR_INVALID_ARGUMENT;
+        return nullptr;
+    }
+
+    // Keep the allocation if it is large enough and the new size would be
+    // served from the same bucket anyway (or directly by the provider).
+    if (Size <= UsableSize) {
+        if (Slab && Size <= getParams().MaxPoolableSize &&
+            findBucket(Size).getSize() == Slab->getBucket().getSize()) {
+            return Ptr;
+        }
+        if (!Slab && Size > getParams().MaxPoolableSize) {
+            return Ptr;
+        }
+    }
+
+    void *NewPtr = allocate(Size, FromPool);
+    if (!NewPtr) {
+        return nullptr;
+    }
+
+    std::memcpy(NewPtr, Ptr, std::min(Size, UsableSize));
+    deallocate(Ptr, ToPool);
+
+    return NewPtr;
+}
+
+size_t DisjointPool::AllocImpl::getUsableSize(void *Ptr) {
+    return getUsableSize(Ptr, findSlab(Ptr));
+}
+
+size_t DisjointPool::AllocImpl::getUsableSize(void *Ptr, Slab *Slab) {
+    if (Slab) {
+        // The pointer might have been aligned within its chunk.
+        size_t Offset = static_cast<char *>(Ptr) -
+                        static_cast<char *>(Slab->getChunkStart(Ptr));
+        return Slab->getBucket().getSize() - Offset;
+    }
+
+    return getLargeSize(Ptr);
+}
+
+void *DisjointPool::AllocImpl::allocateLarge(size_t Size, size_t Alignment) {
+    void *Ptr = memoryProviderAlloc(getMemHandle(), Size, Alignment);
+    if (critnib_insert(LargeAllocs.get(), reinterpret_cast<uintptr_t>(Ptr),
+                       reinterpret_cast<void *>(Size), 0 /* update */) != 0) {
+        memoryProviderFree(getMemHandle(), Ptr, Size);
+        throw MemoryProviderError{UMF_RESULT_ERROR_OUT_OF_HOST_MEMORY};
+    }
+    countProviderAlloc(Size);
+    return Ptr;
+}
+
 std::size_t DisjointPool::AllocImpl::sizeToIdx(size_t Size) {
     assert(Size <= CutOff && "Unexpected size");
     assert(Size > 0 && "Unexpected size");
 
-    size_t MinBucketSize = (size_t)1 << MinBucketSizeExp;
-    if (Size < MinBucketSize) {
+    if (Size <= Buckets[0]->getSize()) {
         return 0;
     }
 
-    // Get the position of the leftmost set bit.
-    size_t position = getLeftmostSetBitPos(Size);
+    // The smallest bucket is at least 8 bytes, so Exp >= SizeLUTSubBits.
+    size_t Val = Size - 1;
+    size_t Exp = utils_mssb_index(Val);
+    size_t Key = (Exp << SizeLUTSubBits) |
+                 ((Val >> (Exp - SizeLUTSubBits)) &
+                  (((size_t)1 << SizeLUTSubBits) - 1));
+
+    // Only buckets within the range of the key have to be skipped.
+    size_t Idx = SizeLUT[Key];
+    while (Buckets[Idx]->getSize() < Size) {
+        Idx++;
+    }
 
-    auto isPowerOf2 = 0 == (Size & (Size - 1));
-    auto largerThanHalfwayBetweenPowersOf2 =
-        !isPowerOf2 && bool((Size - 1) & (uint64_t(1) << (position - 1)));
-    auto index = (position - MinBucketSizeExp) * 2 + (int)(!isPowerOf2) +
-                 (int)largerThanHalfwayBetweenPowersOf2;
+    return Idx;
+}
 
-    return index;
+size_t DisjointPool::AllocImpl::getShardIdx() {
+    if (NumShards == 1) {
+        return 0;
+    }
+
+    unsigned Cpu, Node;
+    if (utils_getcpu(&Cpu, &Node) != 0) {
+        return 0;
+    }
+
+    return (getParams().ShardByCpu ? Cpu : Node) % NumShards;
 }
 
-Bucket &DisjointPool::AllocImpl::findBucket(size_t Size) {
+Bucket &DisjointPool::AllocImpl::findBucket(size_t Size, size_t Alignment) {
     auto calculatedIdx = sizeToIdx(Size);
     assert((*(Buckets[calculatedIdx])).getSize() >= Size);
     if (calculatedIdx > 0) {
         assert((*(Buckets[calculatedIdx - 1])).getSize() < Size);
     }
 
-    return *(Buckets[calculatedIdx]);
+    // Chunks of a bucket are aligned only if its size is a multiple of the
+    // alignment. The last bucket (CutOff) is a multiple of any alignment.
+    while (Buckets[calculatedIdx]->getSize() % Alignment) {
+        calculatedIdx++;
+    }
+
+    return *(Buckets[getShardIdx() * NumBucketsPerShard + calculatedIdx]);
 }
 
-void DisjointPool::AllocImpl::deallocate(void *Ptr, bool &ToPool) {
-    auto *SlabPtr = AlignPtrDown(Ptr, SlabMinSize());
+Bucket &DisjointPool::AllocImpl::findAlignedBucket(size_t Size,
+                                                   size_t Alignment) {
+    size_t AlignmentLog2 = log2Utils(Alignment);
+    assert(AlignmentLog2 <= MaxAlignmentLog2 && Size % Alignment == 0);
+    auto &Set = AlignedBuckets[AlignmentLog2];
+
+    if (!AlignedBucketsReady[AlignmentLog2].load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> Lg(AlignedBucketsLock);
+        if (!AlignedBucketsReady[AlignmentLog2].load(
+                std::memory_order_relaxed)) {
+            // Only sizes which are multiples of the alignment are useful.
+            try {
+                for (size_t I = 0; I < NumBucketsPerShard; I++) {
+                    size_t BucketSize = Buckets[I]->getSize();
+                    if (BucketSize % Alignment == 0) {
+                        Set.push_back(std::make_unique<Bucket>(
+                            BucketSize, *this, Alignment));
+                    }
+                }
+            } catch (std::bad_alloc &) {
+                Set.clear();
+                throw MemoryProviderError{UMF_RESULT_ERROR_OUT_OF_HOST_MEMORY};
+            }
+            AlignedBucketsReady[AlignmentLog2].store(true,
+                                                     std::memory_order_release);
+        }
+    }
+
+    // The last bucket (CutOff) is a multiple of any alignment.
+    auto It = std::lower_bound(
+        Set.begin(), Set.end(), Size,
+        [](const auto &B, size_t Sz) { return B->getSize() < Sz; });
+    assert(It != Set.end());
+    return **It;
+}
 
-    // Lock the map on read
-    std::shared_lock<std::shared_timed_mutex> Lk(getKnownSlabsMapLock());
+template <typename F> void DisjointPool::AllocImpl::forEachBucket(F &&Func) {
+    for (auto &B : Buckets) {
+        Func(*B);
+    }
+    for (size_t I = 0; I <= MaxAlignmentLog2; I++) {
+        if (AlignedBucketsReady[I].load(std::memory_order_acquire)) {
+            for (auto &B : AlignedBuckets[I]) {
+                Func(*B);
+            }
+        }
+    }
+}
 
+void DisjointPool::AllocImpl::deallocate(void *Ptr, bool &ToPool) {
     ToPool = false;
-    auto Slabs = getKnownSlabs().equal_range(SlabPtr);
-    if (Slabs.first == Slabs.second) {
-        Lk.unlock();
-        memoryProviderFree(getMemHandle(), Ptr);
+
+    // The slab object won't be deleted while it holds an allocation, so
+    // it's safe to access it here.
+    auto *Slab = findSlab(Ptr);
+    if (!Slab) {
+        LargeCounters.countFree();
+        size_t Size = getLargeSize(Ptr);
+        if (Size) {
+            // The size stays recorded while the allocation is cached.
+            if (freeToLargeCache(Ptr, Size)) {
+                ToPool = true;
+                return;
+            }
+            forgetLargeSize(Ptr);
+        }
+        countProviderFree(memoryProviderFree(getMemHandle(), Ptr, Size));
+        return;
+    }
+
+    auto &Bucket = Slab->getBucket();
+
+    VALGRIND_DO_MEMPOOL_FREE(this, Ptr);
+    annotate_memory_inaccessible(Ptr, Bucket.getSize());
+    if (Bucket.getSize() <= Bucket.ChunkCutOff()) {
+        auto *Cache = Bucket.getSlabAlignment() ? nullptr : getThreadCache();
+        if (Cache) {
+            // The pointer might have been aligned, so cache the
+            // beginning of the chunk.
+            freeToCache(*Cache, Bucket, Slab->getChunkStart(Ptr));
+            ToPool = true;
+        } else {
+            Bucket.Counters.countFree();
+            Bucket.freeChunk(Ptr, *Slab, ToPool);
+        }
+    } else {
+        Bucket.Counters.countFree();
+        Bucket.freeSlab(*Slab, ToPool);
+    }
+}
+
+Slab *DisjointPool::AllocImpl::findSlab(void *Ptr) {
+    uintptr_t Key = 0;
+    void *Value = nullptr;
+
+    if (!critnib_find(getKnownSlabs(), reinterpret_cast<uintptr_t>(Ptr),
+                      FIND_LE, &Key, &Value)) {
+        return nullptr;
+    }
+
+    auto Tagged = reinterpret_cast<uintptr_t>(Value);
+    if ((Tagged & SlabEndTag) && Key != reinterpret_cast<uintptr_t>(Ptr)) {
+        // The pointer is past the end of the closest slab, e.g. it comes
+        // from a system allocation placed right after a slab.
+        return nullptr;
+    }
+
+    return reinterpret_cast<Slab *>(Tagged & ~SlabEndTag);
+}
+
+ThreadCache *DisjointPool::AllocImpl::getThreadCache() {
+    if (!NumCachedBuckets) {
+        return nullptr;
+    }
+
+    if (LastThreadCache && LastThreadCache->getPoolId() == PoolId) {
+        return LastThreadCache;
+    }
+
+    auto *Cache = LocalThreadCaches.find(PoolId);
+    if (!Cache) {
+        Cache = createThreadCache();
+    }
+
+    LastThreadCache = Cache;
+    return Cache;
+}
+
+ThreadCache *DisjointPool::AllocImpl::createThreadCache() {
+    auto *Cache =
+        new ThreadCache(*this, NumCachedBuckets, getParams().ThreadCacheSize);
+
+    std::lock_guard<std::mutex> Lg(ThreadCacheRegistryLock);
+    try {
+        ThreadCaches.push_back(Cache);
+        LocalThreadCaches.add(Cache);
+    } catch (...) {
+        ThreadCaches.erase(
+            std::remove(ThreadCaches.begin(), ThreadCaches.end(), Cache),
+            ThreadCaches.end());
+        delete Cache;
+        throw;
+    }
+
+    // LastThreadCache might point to a deleted cache of a destroyed pool.
+    LastThreadCache = nullptr;
+
+    return Cache;
+}
+
+void *DisjointPool::AllocImpl::allocateFromCache(ThreadCache &Cache,
+                                                 Bucket &Bucket, size_t Size,
+                                                 bool &FromPool) {
+    size_t Idx = sizeToIdx(Bucket.getSize());
+
+    void *Ptr = Cache.pop(Idx);
+    if (Ptr) {
+        FromPool = true;
+        Cache.getCounters(Idx).countAlloc(Size, FromPool, true);
+        return Ptr;
+    }
+
+    // The magazine is empty, refill a half of it at once.
+    size_t &Count = Cache.getCount(Idx);
+    Count = Bucket.getChunks(Cache.getMagazine(Idx),
+                             std::max(Cache.getCapacity() / 2, (size_t)1),
+                             FromPool);
+
+    Cache.getCounters(Idx).countAlloc(Size, FromPool, true);
+    return Cache.pop(Idx);
+}
+
+void DisjointPool::AllocImpl::freeToCache(ThreadCache &Cache, Bucket &Bucket,
+                                          void *Ptr) {
+    size_t Idx = sizeToIdx(Bucket.getSize());
+
+    Cache.getCounters(Idx).countFree(true);
+    if (Cache.push(Idx, Ptr)) {
+        return;
+    }
+
+    // The magazine is full, return the older half of it to the bucket
+    // and keep the most recently freed chunks.
+    size_t Flush = std::max(Cache.getCapacity() / 2, (size_t)1);
+    flushMagazine(Cache, Idx, Flush);
+
+    Cache.push(Idx, Ptr);
+}
+
+void DisjointPool::AllocImpl::flushMagazine(ThreadCache &Cache, size_t Idx,
+                                            size_t Count) {
+    void **Magazine = Cache.getMagazine(Idx);
+    size_t &Cached = Cache.getCount(Idx);
+    Count = std::min(Count, Cached);
+    if (Count == 0) {
         return;
     }
 
-    for (auto It = Slabs.first; It != Slabs.second; ++It) {
-        // The slab object won't be deleted until it's removed from the map which is
-        // protected by the lock, so it's safe to access it here.
-        auto &Slab = It->second;
-        if (Ptr >= Slab.getPtr() && Ptr < Slab.getEnd()) {
-            // Unlock the map before freeing the chunk, it may be locked on write
-            // there
-            Lk.unlock();
-            auto &Bucket = Slab.getBucket();
+    // Chunks are returned in batches to avoid allocating memory here.
+    static constexpr size_t BatchSize = 64;
+    Slab *Slabs[BatchSize];
+    for (size_t Done = 0; Done < Count; Done += BatchSize) {
+        size_t N = std::min(BatchSize, Count - Done);
+        for (size_t i = 0; i < N; i++) {
+            Slabs[i] = findSlab(Magazine[Done + i]);
+            assert(Slabs[i] && "cached chunk does not belong to any slab");
+        }
+
+        // With multiple shards, chunks of the magazine might come from
+        // buckets of different shards, return each run to its own bucket.
+        for (size_t First = 0, Last = 1; First < N; First = Last++) {
+            auto &Bucket = Slabs[First]->getBucket();
+            while (Last < N && &Slabs[Last]->getBucket() == &Bucket) {
+                Last++;
+            }
+            Bucket.freeChunks(Magazine + Done + First, Slabs + First,
+                              Last - First);
+        }
+    }
+
+    std::copy(Magazine + Count, Magazine + Cached, Magazine);
+    Cached -= Count;
+}
+
+void *DisjointPool::AllocImpl::allocateFromLargeCache(size_t Size,
+                                                      size_t Alignment) {
+    if (!getParams().LargeCacheSize) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> Lg(LargeCacheLock);
+
+    // Best fit, wasting at most 1/8 of the requested size.
+    size_t MaxSize = Size + Size / 8;
+    size_t Best = NumLargeCached;
+    for (size_t I = 0; I < NumLargeCached; I++) {
+        auto &Entry = LargeCache[I];
+        if (Entry.Size < Size || Entry.Size > MaxSize ||
+            (Alignment &&
+             reinterpret_cast<uintptr_t>(Entry.Ptr) % Alignment)) {
+            continue;
+        }
+        if (Best == NumLargeCached || Entry.Size < LargeCache[Best].Size) {
+            Best = I;
+        }
+    }
+    if (Best == NumLargeCached) {
+        return nullptr;
+    }
+
+    void *Ptr = LargeCache[Best].Ptr;
+    LargeCachedBytes -= LargeCache[Best].Size;
+    getLimits()->TotalSize -= LargeCache[Best].Size;
+    LargeCache[Best] = LargeCache[--NumLargeCached];
+
+    return Ptr;
+}
+
+bool DisjointPool::AllocImpl::freeToLargeCache(void *Ptr, size_t Size) {
+    size_t CacheSize = getParams().LargeCacheSize;
+    if (Size > CacheSize) {
+        return false;
+    }
+
+    auto Now = Clock::now();
+    std::lock_guard<std::mutex> Lg(LargeCacheLock);
 
-            if (getParams().PoolTrace > 1) {
-                Bucket.countFree();
+    decayLargeCache(Now, false);
+
+    // Make room by releasing the least recently freed allocations.
+    while (NumLargeCached &&
+           (NumLargeCached == LargeCacheCapacity ||
+            LargeCachedBytes + Size > CacheSize)) {
+        size_t Oldest = 0;
+        for (size_t I = 1; I < NumLargeCached; I++) {
+            if (LargeCache[I].FreedTime < LargeCache[Oldest].FreedTime) {
+                Oldest = I;
             }
+        }
+        releaseLargeCached(Oldest);
+    }
+
+    // The cached memory counts as the pool size, like slabs in the pool.
+    auto *Limits = getLimits();
+    size_t PoolSize = Limits->TotalSize;
+    do {
+        if (Limits->MaxSize < PoolSize + Size) {
+            return false;
+        }
+    } while (!Limits->TotalSize.compare_exchange_strong(PoolSize,
+                                                        PoolSize + Size));
+
+    LargeCache[NumLargeCached++] = {Ptr, Size, Now, false};
+    LargeCachedBytes += Size;
+    annotate_memory_inaccessible(Ptr, Size);
+
+    auto &Params = getParams();
+    size_t DelayMs = Params.PurgeDelayMs;
+    if (!DelayMs ||
+        (Params.ReleaseDelayMs && Params.ReleaseDelayMs < DelayMs)) {
+        DelayMs = Params.ReleaseDelayMs;
+    }
+    if (DelayMs) {
+        LargeCacheNextDecay = std::min(
+            LargeCacheNextDecay, Now + std::chrono::milliseconds(DelayMs));
+    }
+
+    return true;
+}
+
+void DisjointPool::AllocImpl::decayLargeCache(Clock::time_point Now,
+                                              bool Force) {
+    if (!Force && Now < LargeCacheNextDecay) {
+        return;
+    }
+
+    auto &Params = getParams();
+    auto PurgeDelay = std::chrono::milliseconds(Params.PurgeDelayMs);
+    auto ReleaseDelay = std::chrono::milliseconds(Params.ReleaseDelayMs);
+
+    LargeCacheNextDecay = Clock::time_point::max();
+    for (size_t I = 0; I < NumLargeCached;) {
+        auto &Entry = LargeCache[I];
+        if (Force ||
+            (Params.ReleaseDelayMs && Now >= Entry.FreedTime + ReleaseDelay)) {
+            // The last entry is moved to this place.
+            releaseLargeCached(I);
+            continue;
+        }
 
-            VALGRIND_DO_MEMPOOL_FREE(this, Ptr);
-            annotate_memory_inaccessible(Ptr, Bucket.getSize());
-            if (Bucket.getSize() <= Bucket.ChunkCutOff()) {
-                Bucket.freeChunk(Ptr, Slab, ToPool);
+        if (Params.PurgeDelayMs && !Entry.Purged) {
+            if (Now >= Entry.FreedTime + PurgeDelay) {
+                auto ret = umfMemoryProviderPurgeLazy(getMemHandle(),
+                                                      Entry.Ptr, Entry.Size);
+                if (ret != UMF_RESULT_SUCCESS) {
+                    LOG_DEBUG("DisjointPool: purging a cached allocation "
+                              "failed: %d",
+                              ret);
+                }
+                Entry.Purged = true;
             } else {
-                Bucket.freeSlab(Slab, ToPool);
+                LargeCacheNextDecay =
+                    std::min(LargeCacheNextDecay, Entry.FreedTime + PurgeDelay);
             }
+        }
 
-            return;
+        if (Params.ReleaseDelayMs) {
+            LargeCacheNextDecay =
+                std::min(LargeCacheNextDecay, Entry.FreedTime + ReleaseDelay);
         }
+
+        I++;
     }
+}
+
+void DisjointPool::AllocImpl::releaseLargeCached(size_t I) {
+    auto Entry = LargeCache[I];
+    LargeCache[I] = LargeCache[--NumLargeCached];
+    LargeCachedBytes -= Entry.Size;
+    getLimits()->TotalSize -= Entry.Size;
+    forgetLargeSize(Entry.Ptr);
 
-    Lk.unlock();
-    // There is a rare case when we have a pointer from system allocation next
-    // to some slab with an entry in the map. So we find a slab
-    // but the range checks fail.
-    memoryProviderFree(getMemHandle(), Ptr);
+    try {
+        memoryProviderFree(getMemHandle(), Entry.Ptr, Entry.Size);
+        countProviderFree(Entry.Size);
+    } catch (MemoryProviderError &e) {
+        LOG_ERR("DisjointPool: error from memory provider: %d", e.code);
+    }
+}
+
+void *DisjointPool::AllocImpl::allocSlabMemory(size_t Size, size_t Alignment,
+                                               SlabExtent *&Extent,
+                                               bool &Fresh) {
+    if (Size > ExtentSlotSize || Alignment) {
+        Extent = nullptr;
+        Fresh = true;
+        void *Ptr = memoryProviderAlloc(getMemHandle(), Size, Alignment);
+        countProviderAlloc(Size);
+        return Ptr;
+    }
+
+    std::lock_guard<std::mutex> Lg(ExtentsLock);
+
+    if (!PartialExtents) {
+        if (EmptyExtent) {
+            linkExtent(EmptyExtent);
+            EmptyExtent = nullptr;
+        } else {
+            size_t NumWords = (SlotsPerExtent + 63) / 64;
+            auto *NewExtent = static_cast<SlabExtent *>(umf_ba_global_alloc(
+                sizeof(SlabExtent) + NumWords * sizeof(uint64_t)));
+            if (!NewExtent) {
+                throw MemoryProviderError{UMF_RESULT_ERROR_OUT_OF_HOST_MEMORY};
+            }
+
+            size_t ExtentSize = SlotsPerExtent * ExtentSlotSize;
+            try {
+                NewExtent->MemPtr =
+                    memoryProviderAlloc(getMemHandle(), ExtentSize);
+            } catch (...) {
+                umf_ba_global_free(NewExtent);
+                throw;
+            }
+            countProviderAlloc(ExtentSize);
+
+            NewExtent->NumFree = SlotsPerExtent;
+            NewExtent->FreshFrom = 0;
+            auto *Bitmap = NewExtent->getBitmap();
+            for (size_t I = 0; I < NumWords; I++) {
+                Bitmap[I] = ~uint64_t(0);
+            }
+            if (SlotsPerExtent % 64) {
+                Bitmap[NumWords - 1] =
+                    (uint64_t(1) << (SlotsPerExtent % 64)) - 1;
+            }
+            linkExtent(NewExtent);
+        }
+    }
+
+    Extent = PartialExtents;
+    auto *Bitmap = Extent->getBitmap();
+    size_t Word = 0;
+    while (!Bitmap[Word]) {
+        Word++;
+    }
+    size_t Slot = Word * 64 + utils_lssb_index(Bitmap[Word]);
+    Bitmap[Word] &= ~(uint64_t(1) << (Slot % 64));
+
+    // The slots of an extent kept empty for reuse can be dirty.
+    Fresh = Slot >= Extent->FreshFrom;
+    if (Fresh) {
+        Extent->FreshFrom = Slot + 1;
+    }
+
+    if (--Extent->NumFree == 0) {
+        unlinkExtent(Extent);
+    }
+
+    return static_cast<char *>(Extent->MemPtr) + Slot * ExtentSlotSize;
+}
+
+void DisjointPool::AllocImpl::freeSlabMemory(void *Ptr, size_t Size,
+                                             SlabExtent *Extent) {
+    if (!Extent) {
+        memoryProviderFree(getMemHandle(), Ptr);
+        countProviderFree(Size);
+        return;
+    }
+
+    std::lock_guard<std::mutex> Lg(ExtentsLock);
+
+    size_t Slot = (static_cast<char *>(Ptr) -
+                   static_cast<char *>(Extent->MemPtr)) /
+                  ExtentSlotSize;
+    Extent->getBitmap()[Slot / 64] |= uint64_t(1) << (Slot % 64);
+
+    if (Extent->NumFree++ == 0) {
+        linkExtent(Extent);
+    }
+    if (Extent->NumFree < SlotsPerExtent) {
+        return;
+    }
+
+    // Keep one free extent to avoid allocating and freeing extents
+    // repeatedly when a slab is created and destroyed.
+    unlinkExtent(Extent);
+    if (!EmptyExtent) {
+        EmptyExtent = Extent;
+        return;
+    }
+    releaseExtent(Extent);
+}
+
+void DisjointPool::AllocImpl::releaseExtent(SlabExtent *Extent) {
+    try {
+        memoryProviderFree(getMemHandle(), Extent->MemPtr);
+        countProviderFree(SlotsPerExtent * ExtentSlotSize);
+    } catch (MemoryProviderError &e) {
+        LOG_ERR("DisjointPool: error from memory provider: %d", e.code);
+    }
+    umf_ba_global_free(Extent);
+}
+
+void DisjointPool::AllocImpl::linkExtent(SlabExtent *Extent) {
+    Extent->Prev = nullptr;
+    Extent->Next = PartialExtents;
+    if (PartialExtents) {
+        PartialExtents->Prev = Extent;
+    }
+    PartialExtents = Extent;
+}
+
+void DisjointPool::AllocImpl::unlinkExtent(SlabExtent *Extent) {
+    if (Extent->Prev) {
+        Extent->Prev->Next = Extent->Next;
+    } else {
+        PartialExtents = Extent->Next;
+    }
+    if (Extent->Next) {
+        Extent->Next->Prev = Extent->Prev;
+    }
+}
+
+void DisjointPool::AllocImpl::flushThreadCache(ThreadCache &Cache) {
+    for (size_t Idx = 0; Idx < Cache.getNumBuckets(); Idx++) {
+        flushMagazine(Cache, Idx, Cache.getCount(Idx));
+    }
+}
+
+void DisjointPool::AllocImpl::unregisterThreadCache(ThreadCache &Cache) {
+    // Keep the statistics of the thread in the first shard.
+    for (size_t Idx = 0; Idx < Cache.getNumBuckets(); Idx++) {
+        Buckets[Idx]->Counters.add(Cache.getCounters(Idx));
+    }
+
+    ThreadCaches.erase(
+        std::remove(ThreadCaches.begin(), ThreadCaches.end(), &Cache),
+        ThreadCaches.end());
+}
+
+DisjointPool::AllocImpl::~AllocImpl() {
+    {
+        std::lock_guard<std::mutex> Lg(ThreadCacheRegistryLock);
+        for (auto *Cache : ThreadCaches) {
+            try {
+                flushThreadCache(*Cache);
+            } catch (...) {
+                LOG_ERR("DisjointPool: failed to flush a thread cache");
+            }
+            // The cache will be deleted by its thread.
+            Cache->detach();
+        }
+        ThreadCaches.clear();
+    }
+
+    {
+        std::lock_guard<std::mutex> Lg(LargeCacheLock);
+        decayLargeCache(Clock::now(), true);
+    }
+
+    // Destroy the slabs first to return their memory to the extents.
+    Buckets.clear();
+    for (auto &Set : AlignedBuckets) {
+        Set.clear();
+    }
+    if (EmptyExtent) {
+        releaseExtent(EmptyExtent);
+    }
+    assert(!PartialExtents && "slab extents still in use");
+
+    VALGRIND_DO_DESTROY_MEMPOOL(this);
+}
+
+ThreadCacheList::~ThreadCacheList() {
+    std::lock_guard<std::mutex> Lg(ThreadCacheRegistryLock);
+    for (auto *Cache : Caches) {
+        auto *Owner = Cache->getOwner();
+        if (Owner) {
+            try {
+                Owner->flushThreadCache(*Cache);
+            } catch (...) {
+                LOG_ERR("DisjointPool: failed to flush a thread cache");
+            }
+            Owner->unregisterThreadCache(*Cache);
+        }
+        delete Cache;
+    }
+    LastThreadCache = nullptr;
+}
+
+void DisjointPool::AllocImpl::trim() {
+    // Chunks cached by the calling thread keep their slabs in use. Caches of
+    // other threads cannot be flushed from here.
+    if (NumCachedBuckets) {
+        auto *Cache = LocalThreadCaches.find(PoolId);
+        if (Cache) {
+            flushThreadCache(*Cache);
+        }
+    }
+
+    forEachBucket([](Bucket &B) { B.trim(); });
+
+    {
+        std::lock_guard<std::mutex> Lg(ExtentsLock);
+        if (EmptyExtent) {
+            releaseExtent(EmptyExtent);
+            EmptyExtent = nullptr;
+        }
+    }
+
+    std::lock_guard<std::mutex> Lg(LargeCacheLock);
+    decayLargeCache(Clock::now(), true);
+}
+
+std::vector<umf_disjoint_pool_bucket_stats_t>
+DisjointPool::AllocImpl::collectBucketStats() {
+    std::vector<umf_disjoint_pool_bucket_stats_t> Stats(NumBucketsPerShard);
+
+    for (size_t I = 0; I < Buckets.size(); I++) {
+        auto &BucketStats = Stats[I % NumBucketsPerShard];
+        BucketStats.Size = Buckets[I]->getSize();
+        Buckets[I]->addStats(BucketStats);
+    }
+
+    // Aligned buckets are accounted to the default bucket of the same size.
+    for (size_t I = 0; I <= MaxAlignmentLog2; I++) {
+        if (!AlignedBucketsReady[I].load(std::memory_order_acquire)) {
+            continue;
+        }
+        for (auto &B : AlignedBuckets[I]) {
+            auto It = std::lower_bound(
+                Stats.begin(), Stats.end(), B->getSize(),
+                [](const auto &S, size_t Sz) { return S.Size < Sz; });
+            assert(It != Stats.end() && It->Size == B->getSize());
+            B->addStats(*It);
+        }
+    }
+
+    std::lock_guard<std::mutex> Lg(ThreadCacheRegistryLock);
+    for (auto *Cache : ThreadCaches) {
+        for (size_t Idx = 0; Idx < Cache->getNumBuckets(); Idx++) {
+            Cache->getCounters(Idx).addTo(Stats[Idx]);
+        }
+    }
+
+    return Stats;
+}
+
+void DisjointPool::AllocImpl::getStats(
+    umf_disjoint_pool_stats_t *Stats,
+    umf_disjoint_pool_bucket_stats_t *BucketStats, size_t *NumBuckets) {
+    auto AllBucketStats = collectBucketStats();
+
+    if (BucketStats) {
+        std::copy_n(AllBucketStats.begin(),
+                    std::min(*NumBuckets, AllBucketStats.size()), BucketStats);
+    }
+    if (NumBuckets) {
+        *NumBuckets = AllBucketStats.size();
+    }
+
+    if (!Stats) {
+        return;
+    }
+
+    umf_disjoint_pool_bucket_stats_t Large = {};
+    LargeCounters.addTo(Large);
+
+    *Stats = {};
+    Stats->AllocCount = Large.AllocCount;
+    Stats->FreeCount = Large.FreeCount;
+    Stats->BytesRequested = Large.BytesRequested;
+    Stats->BytesUsed = Large.BytesRequested;
+    for (size_t I = 0; I < AllBucketStats.size(); I++) {
+        auto &B = AllBucketStats[I];
+        Stats->AllocCount += B.AllocCount;
+        Stats->FreeCount += B.FreeCount;
+        Stats->BytesRequested += B.BytesRequested;
+        Stats->BytesUsed += B.AllocCount * B.Size;
+        Stats->PoolBytes += B.SlabsInPool * Buckets[I]->SlabAllocSize();
+    }
+    {
+        std::lock_guard<std::mutex> Lg(LargeCacheLock);
+        Stats->PoolBytes += LargeCachedBytes;
+    }
+    Stats->ProviderAllocCount =
+        ProviderAllocCount.load(std::memory_order_relaxed);
+    Stats->ProviderFreeCount =
+        ProviderFreeCount.load(std::memory_order_relaxed);
+    Stats->ProviderBytes = ProviderBytes.load(std::memory_order_relaxed);
 }
 
 void DisjointPool::AllocImpl::printStats(bool &TitlePrinted,
                                          size_t &HighBucketSize,
                                          size_t &HighPeakSlabsInUse,
-                                         const std::string &MTName) {
+                                         const char *MTName) {
     HighBucketSize = 0;
     HighPeakSlabsInUse = 0;
-    for (auto &B : Buckets) {
-        (*B).printStats(TitlePrinted, MTName);
-        HighPeakSlabsInUse = std::max((*B).maxSlabsInUse, HighPeakSlabsInUse);
-        if ((*B).allocCount) {
-            HighBucketSize = std::max((*B).SlabAllocSize(), HighBucketSize);
+    auto Stats = collectBucketStats();
+    for (size_t I = 0; I < Stats.size(); I++) {
+        auto &B = Stats[I];
+        HighPeakSlabsInUse = std::max(B.MaxSlabsInUse, HighPeakSlabsInUse);
+        if (!B.AllocCount) {
+            continue;
+        }
+        HighBucketSize = std::max(Buckets[I]->SlabAllocSize(), HighBucketSize);
+
+        if (!TitlePrinted) {
+            printf("%s memory statistics\n", MTName);
+            printf("%14s%12s%12s%18s%20s%21s\n", "Bucket Size", "Allocs",
+                   "Frees", "Allocs from Pool", "Peak Slabs in Use",
+                   "Peak Slabs in Pool");
+            TitlePrinted = true;
         }
+        printf("%14zu%12zu%12zu%18zu%20zu%21zu\n", B.Size, B.AllocCount,
+               B.FreeCount, B.AllocPoolCount, B.MaxSlabsInUse,
+               B.MaxSlabsInPool);
     }
 }
 
@@ -1026,6 +2599,19 @@ umf_result_t DisjointPool::initialize(umf_memory_provider_handle_t provider,
         !((parameters->MinBucketSize & (parameters->MinBucketSize - 1)) == 0)) {
         return UMF_RESULT_ERROR_INVALID_ARGUMENT;
     }
+    // The same applies to ClassesPerPowerOf2, if set.
+    if (parameters->ClassesPerPowerOf2 &
+        (parameters->ClassesPerPowerOf2 - 1)) {
+        return UMF_RESULT_ERROR_INVALID_ARGUMENT;
+    }
+    if (parameters->NumBucketSizes && parameters->BucketSizes) {
+        for (size_t i = 0; i < parameters->NumBucketSizes; i++) {
+            if (!parameters->BucketSizes[i] ||
+                parameters->BucketSizes[i] > CutOff) {
+                return UMF_RESULT_ERROR_INVALID_ARGUMENT;
+            }
+        }
+    }
 
     impl = std::make_unique<AllocImpl>(provider, parameters);
     return UMF_RESULT_SUCCESS;
@@ -1036,24 +2622,26 @@ void *DisjointPool::malloc(size_t size) { // For full-slab allocations indicates
     bool FromPool;
     auto Ptr = impl->allocate(size, FromPool);
 
-    if (impl->getParams().PoolTrace > 2) {
-        auto MT = impl->getParams().Name;
-        std::cout << "Allocated " << std::setw(8) << size << " " << MT
-                  << " bytes from " << (FromPool ? "Pool" : "Provider") << " ->"
-                  << Ptr << std::endl;
-    }
+    TRACE_POOL_OPERATION(impl, "Allocated %8zu %s bytes from %s -> %p", size,
+                         impl->getParams().Name,
+                         FromPool ? "Pool" : "Provider", Ptr);
     return Ptr;
 }
 
-void *DisjointPool::calloc(size_t, size_t) {
-    // Not supported
-    umf::getPoolLastStatusRef<DisjointPool>() = UMF_RESULT_ERROR_NOT_SUPPORTED;
-    return NULL;
+void *DisjointPool::calloc(size_t num, size_t size) {
+    if (size && num > std::numeric_limits<size_t>::max() / size) {
+        umf::getPoolLastStatusRef<DisjointPool>() =
+            UMF_RESULT_ERROR_INVALID_ARGUMENT;
+        return NULL;
+    }
+
+    return impl->allocateZeroed(num * size);
 }
 
-void *DisjointPool::realloc(void *, size_t) {
-    // Not supported
-    umf::getPoolLastStatusRef<DisjointPool>() = UMF_RESULT_ERROR_NOT_SUPPORTED;
+void *DisjointPool::realloc(void *ptr, size_t size) try {
+    return impl->reallocate(ptr, size);
+} catch (MemoryProviderError &e) {
+    umf::getPoolLastStatusRef<DisjointPool>() = e.code;
     return NULL;
 }
 
@@ -1061,34 +2649,32 @@ void *DisjointPool::aligned_malloc(size_t size, size_t alignment) {
     bool FromPool;
     auto Ptr = impl->allocate(size, alignment, FromPool);
 
-    if (impl->getParams().PoolTrace > 2) {
-        auto MT = impl->getParams().Name;
-        std::cout << "Allocated " << std::setw(8) << size << " " << MT
-                  << " bytes aligned at " << alignment << " from "
-                  << (FromPool ? "Pool" : "Provider") << " ->" << Ptr
-                  << std::endl;
-    }
+    TRACE_POOL_OPERATION(impl,
+                         "Allocated %8zu %s bytes aligned at %zu from %s -> %p",
+                         size, impl->getParams().Name, alignment,
+                         FromPool ? "Pool" : "Provider", Ptr);
     return Ptr;
 }
 
-size_t DisjointPool::malloc_usable_size(void *) {
-    // Not supported
-    return 0;
+size_t DisjointPool::malloc_usable_size(void *ptr) {
+    if (!ptr) {
+        return 0;
+    }
+
+    return impl->getUsableSize(ptr);
 }
 
 umf_result_t DisjointPool::free(void *ptr) try {
     bool ToPool;
     impl->deallocate(ptr, ToPool);
 
-    if (impl->getParams().PoolTrace > 2) {
-        auto MT = impl->getParams().Name;
-        std::cout << "Freed " << MT << " " << ptr << " to "
-                  << (ToPool ? "Pool" : "Provider")
-                  << ", Current total pool size "
-                  << impl->getLimits()->TotalSize.load()
-                  << ", Current pool size for " << MT << " "
-                  << impl->getParams().CurPoolSize << "\n";
-    }
+    TRACE_POOL_OPERATION(impl,
+                         "Freed %s %p to %s, Current total pool size %zu, "
+                         "Current pool size for %s %zu",
+                         impl->getParams().Name, ptr,
+                         ToPool ? "Pool" : "Provider",
+                         impl->getLimits()->TotalSize.load(),
+                         impl->getParams().Name, impl->getParams().CurPoolSize);
     return UMF_RESULT_SUCCESS;
 } catch (MemoryProviderError &e) {
     return e.code;
@@ -1098,6 +2684,23 @@ umf_result_t DisjointPool::get_last_allocation_error() {
     return umf::getPoolLastStatusRef<DisjointPool>();
 }
 
+umf_result_t DisjointPool::trim() try {
+    impl->trim();
+    return UMF_RESULT_SUCCESS;
+} catch (MemoryProviderError &e) {
+    return e.code;
+}
+
+umf_result_t
+DisjointPool::get_stats(umf_disjoint_pool_stats_t *Stats,
+                        umf_disjoint_pool_bucket_stats_t *BucketStats,
+                        size_t *NumBuckets) try {
+    impl->getStats(Stats, BucketStats, NumBuckets);
+    return UMF_RESULT_SUCCESS;
+} catch (std::bad_alloc &) {
+    return UMF_RESULT_ERROR_OUT_OF_HOST_MEMORY;
+}
+
 DisjointPool::DisjointPool() {}
 
 // Define destructor for use with unique_ptr
@@ -1105,18 +2708,18 @@ DisjointPool::~DisjointPool() {
     bool TitlePrinted = false;
     size_t HighBucketSize;
     size_t HighPeakSlabsInUse;
-    if (impl->getParams().PoolTrace > 1) {
+    // impl is not set if the initialization failed
+    if (impl && impl->getParams().PoolTrace > 1) {
         auto name = impl->getParams().Name;
         try { // cannot throw in destructor
             impl->printStats(TitlePrinted, HighBucketSize, HighPeakSlabsInUse,
                              name);
             if (TitlePrinted) {
-                std::cout << "Current Pool Size "
-                          << impl->getLimits()->TotalSize.load() << std::endl;
-                std::cout << "Suggested Setting=;"
-                          << std::string(1, (char)tolower(name[0]))
-                          << std::string(name + 1) << ":" << HighBucketSize
-                          << "," << HighPeakSlabsInUse << ",64K" << std::endl;
+                printf("Current Pool Size %zu\n",
+                       impl->getLimits()->TotalSize.load());
+                printf("Suggested Setting=;%c%s:%zu,%zu,64K\n",
+                       (char)tolower(name[0]), name[0] ? name + 1 : "",
+                       HighBucketSize, HighPeakSlabsInUse);
             }
         } catch (...) { // ignore exceptions
         }
@@ -1129,3 +2732,35 @@ static umf_memory_pool_ops_t UMF_DISJOINT_POOL_OPS =
 umf_memory_pool_ops_t *umfDisjointPoolOps(void) {
     return &UMF_DISJOINT_POOL_OPS;
 }
+
+// Return the disjoint pool of the given handle, nullptr if the handle is not
+// a disjoint pool.
+static DisjointPool *getDisjointPool(umf_memory_pool_handle_t hPool) {
+    if (!hPool || hPool->ops.initialize != UMF_DISJOINT_POOL_OPS.initialize) {
+        return nullptr;
+    }
+
+    return static_cast<DisjointPool *>(hPool->pool_priv);
+}
+
+umf_result_t umfDisjointPoolTrim(umf_memory_pool_handle_t hPool) {
+    auto *Pool = getDisjointPool(hPool);
+    if (!Pool) {
+        return UMF_RESULT_ERROR_INVALID_ARGUMENT;
+    }
+
+    return Pool->trim();
+}
+
+umf_result_t
+umfDisjointPoolGetStats(umf_memory_pool_handle_t hPool,
+                        umf_disjoint_pool_stats_t *Stats,
+                        umf_disjoint_pool_bucket_stats_t *BucketStats,
+                        size_t *NumBuckets) {
+    auto *Pool = getDisjointPool(hPool);
+    if (!Pool || (BucketStats && !NumBuckets)) {
+        return UMF_RESULT_ERROR_INVALID_ARGUMENT;
+    }
+
+    return Pool->get_stats(Stats, BucketStats, NumBuckets);
+}
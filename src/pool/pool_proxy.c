@@ -97,9 +97,9 @@ static umf_result_t proxy_free(void *pool, void *ptr) {
     struct proxy_memory_pool *hPool = (struct proxy_memory_pool *)pool;
 
     if (ptr) {
-        umf_alloc_info_t allocInfo = {NULL, 0, NULL};
+        umf_alloc_info_t allocInfo = {NULL, 0, NULL, false};
         umf_result_t umf_result = umfMemoryTrackerGetAllocInfo(ptr, &allocInfo);
-        if (umf_result == UMF_RESULT_SUCCESS) {
+        if (umf_result == UMF_RESULT_SUCCESS && !allocInfo.coarse) {
             size = allocInfo.baseSize;
         }
     }
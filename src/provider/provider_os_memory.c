@@ -411,6 +411,8 @@ static umf_result_t translate_params(umf_os_memory_provider_params_t *in_params,
 
     // IPC API requires in_params->visibility == UMF_MEM_MAP_SHARED
     provider->IPC_enabled = (in_params->visibility == UMF_MEM_MAP_SHARED);
+    provider->ipc_map_segments =
+        provider->IPC_enabled && in_params->ipc_map_segments;
 
     // NUMA config
     int emptyNodeset = in_params->numa_list_len == 0;
@@ -511,6 +513,14 @@ static umf_result_t os_initialize(void *params, void **provider) {
     }
 
     if (os_provider->fd > 0) {
+        if (utils_get_file_id(os_provider->fd, &os_provider->fd_dev,
+                              &os_provider->fd_ino)) {
+            LOG_ERR("getting the device and inode numbers of the file for "
+                    "memory mapping failed");
+            ret = UMF_RESULT_ERROR_UNKNOWN;
+            goto err_destroy_bitmaps;
+        }
+
         if (utils_mutex_init(&os_provider->lock_fd) == NULL) {
             LOG_ERR("initializing the file size lock failed");
             ret = UMF_RESULT_ERROR_UNKNOWN;
@@ -518,6 +528,14 @@ static umf_result_t os_initialize(void *params, void **provider) {
         }
     }
 
+    if (os_provider->ipc_map_segments) {
+        if (utils_mutex_init(&os_provider->lock_ipc_segments) == NULL) {
+            LOG_ERR("initializing the IPC segments lock failed");
+            ret = UMF_RESULT_ERROR_UNKNOWN;
+            goto err_destroy_lock_fd;
+        }
+    }
+
     os_provider->nodeset_str_buf = umf_ba_global_alloc(NODESET_STR_BUF_LEN);
     if (!os_provider->nodeset_str_buf) {
         LOG_INFO("allocating memory for printing NUMA nodes failed");
@@ -536,6 +554,10 @@ static umf_result_t os_initialize(void *params, void **provider) {
 
     return UMF_RESULT_SUCCESS;
 
+err_destroy_lock_fd:
+    if (os_provider->fd > 0) {
+        utils_mutex_destroy_not_free(&os_provider->lock_fd);
+    }
 err_destroy_bitmaps:
     free_bitmaps(os_provider);
 err_destroy_critnib:
@@ -547,6 +569,8 @@ err_free_os_provider:
     return ret;
 }
 
+static void os_ipc_segments_destroy(os_memory_provider_t *os_provider);
+
 static void os_finalize(void *provider) {
     if (provider == NULL) {
         assert(0);
@@ -559,6 +583,11 @@ static void os_finalize(void *provider) {
         utils_mutex_destroy_not_free(&os_provider->lock_fd);
     }
 
+    if (os_provider->ipc_map_segments) {
+        os_ipc_segments_destroy(os_provider);
+        utils_mutex_destroy_not_free(&os_provider->lock_ipc_segments);
+    }
+
     critnib_delete(os_provider->fd_offset_map);
 
     free_bitmaps(os_provider);
@@ -1155,6 +1184,8 @@ typedef struct os_ipc_data_t {
     size_t size;
     unsigned protection; // combination of OS-specific protection flags
     unsigned visibility; // memory visibility mode
+    uint64_t dev;        // device number of the file
+    uint64_t ino;        // inode number of the file
     // shm_name is a Flexible Array Member because it is optional and its size
     // varies on the Shared Memory object name
     size_t shm_name_len;
@@ -1204,6 +1235,8 @@ static umf_result_t os_get_ipc_handle(void *provider, const void *ptr,
     os_ipc_data->size = size;
     os_ipc_data->protection = os_provider->protection;
     os_ipc_data->visibility = os_provider->visibility;
+    os_ipc_data->dev = os_provider->fd_dev;
+    os_ipc_data->ino = os_provider->fd_ino;
     os_ipc_data->shm_name_len = strlen(os_provider->shm_name);
     if (os_ipc_data->shm_name_len > 0) {
         strncpy(os_ipc_data->shm_name, os_provider->shm_name,
@@ -1249,6 +1282,179 @@ static umf_result_t os_put_ipc_handle(void *provider, void *providerIpcData) {
     return UMF_RESULT_SUCCESS;
 }
 
+// open the file used for memory mappings by the producer of the IPC handle
+static umf_result_t os_open_ipc_fd(os_ipc_data_t *os_ipc_data, int *fd) {
+    if (os_ipc_data->shm_name_len) {
+        *fd = utils_shm_open(os_ipc_data->shm_name);
+        if (*fd <= 0) {
+            LOG_PERR("opening a shared memory file (%s) failed",
+                     os_ipc_data->shm_name);
+            return UMF_RESULT_ERROR_UNKNOWN;
+        }
+        (void)utils_shm_unlink(os_ipc_data->shm_name);
+    } else {
+        umf_result_t umf_result =
+            utils_duplicate_fd(os_ipc_data->pid, os_ipc_data->fd, fd);
+        if (umf_result != UMF_RESULT_SUCCESS) {
+            LOG_PERR("duplicating file descriptor failed");
+            return umf_result;
+        }
+    }
+
+    return UMF_RESULT_SUCCESS;
+}
+
+static bool os_ipc_segment_match(os_ipc_segment_t *segment,
+                                 os_ipc_data_t *os_ipc_data) {
+    return segment->dev == os_ipc_data->dev && segment->ino == os_ipc_data->ino;
+}
+
+// Open the IPC handle in the mapping of the memory segment of its producer.
+// The segment is opened and mapped only by the first handle and remapped
+// only when a handle points beyond the current mapping, so opening other
+// handles does not make any system calls.
+static umf_result_t os_open_ipc_segment(os_memory_provider_t *os_provider,
+                                        os_ipc_data_t *os_ipc_data,
+                                        void **ptr) {
+    umf_result_t ret = UMF_RESULT_SUCCESS;
+
+    if (os_ipc_data->shm_name_len >= NAME_MAX) {
+        LOG_ERR("too long name of a shared memory file: %zu",
+                os_ipc_data->shm_name_len);
+        return UMF_RESULT_ERROR_INVALID_ARGUMENT;
+    }
+
+    utils_mutex_lock(&os_provider->lock_ipc_segments);
+
+    os_ipc_segment_t *segment = os_provider->ipc_segments;
+    while (segment && !os_ipc_segment_match(segment, os_ipc_data)) {
+        segment = segment->next;
+    }
+
+    if (segment == NULL) {
+        segment = umf_ba_global_alloc(sizeof(*segment));
+        if (segment == NULL) {
+            LOG_ERR("allocating an IPC segment failed");
+            ret = UMF_RESULT_ERROR_OUT_OF_HOST_MEMORY;
+            goto err_unlock;
+        }
+
+        memset(segment, 0, sizeof(*segment));
+
+        ret = os_open_ipc_fd(os_ipc_data, &segment->local_fd);
+        if (ret != UMF_RESULT_SUCCESS) {
+            umf_ba_global_free(segment);
+            goto err_unlock;
+        }
+
+        // the producer's fd number or the name of its shared memory file
+        // could have been reused for another file since the handle was got
+        if (utils_get_file_id(segment->local_fd, &segment->dev,
+                              &segment->ino) ||
+            !os_ipc_segment_match(segment, os_ipc_data)) {
+            LOG_ERR("the file of the IPC handle was closed by its producer");
+            (void)utils_close_fd(segment->local_fd);
+            umf_ba_global_free(segment);
+            ret = UMF_RESULT_ERROR_INVALID_ARGUMENT;
+            goto err_unlock;
+        }
+
+        segment->next = os_provider->ipc_segments;
+        os_provider->ipc_segments = segment;
+    }
+
+    os_ipc_window_t *window = segment->windows;
+    size_t end = os_ipc_data->fd_offset + os_ipc_data->size;
+    if (window == NULL || window->size < end) {
+        // grow the mapping at least twice to map the segment
+        // only a logarithmic number of times
+        size_t size = window ? 2 * window->size : 0;
+        if (size < end) {
+            size = end;
+        }
+        size = ALIGN_UP(size, utils_get_page_size());
+
+        window = umf_ba_global_alloc(sizeof(*window));
+        if (window == NULL) {
+            LOG_ERR("allocating an IPC segment window failed");
+            ret = UMF_RESULT_ERROR_OUT_OF_HOST_MEMORY;
+            goto err_unlock;
+        }
+
+        window->addr = utils_mmap(NULL, size, os_ipc_data->protection,
+                                  os_ipc_data->visibility, segment->local_fd,
+                                  0);
+        if (window->addr == NULL) {
+            os_store_last_native_error(UMF_OS_RESULT_ERROR_ALLOC_FAILED,
+                                       errno);
+            LOG_PERR("memory mapping of an IPC segment failed");
+            umf_ba_global_free(window);
+            ret = UMF_RESULT_ERROR_MEMORY_PROVIDER_SPECIFIC;
+            goto err_unlock;
+        }
+
+        LOG_DEBUG("mapped %zu bytes of an IPC segment at %p", size,
+                  window->addr);
+
+        window->size = size;
+        window->next = segment->windows;
+        segment->windows = window;
+    }
+
+    *ptr = (char *)window->addr + os_ipc_data->fd_offset;
+
+err_unlock:
+    utils_mutex_unlock(&os_provider->lock_ipc_segments);
+    return ret;
+}
+
+// check if ptr points to a mapping of an IPC segment
+static bool os_ipc_segment_contains(os_memory_provider_t *os_provider,
+                                    void *ptr) {
+    bool found = false;
+
+    utils_mutex_lock(&os_provider->lock_ipc_segments);
+
+    for (os_ipc_segment_t *segment = os_provider->ipc_segments;
+         segment && !found; segment = segment->next) {
+        for (os_ipc_window_t *window = segment->windows; window;
+             window = window->next) {
+            if ((uintptr_t)ptr >= (uintptr_t)window->addr &&
+                (uintptr_t)ptr - (uintptr_t)window->addr < window->size) {
+                found = true;
+                break;
+            }
+        }
+    }
+
+    utils_mutex_unlock(&os_provider->lock_ipc_segments);
+
+    return found;
+}
+
+static void os_ipc_segments_destroy(os_memory_provider_t *os_provider) {
+    os_ipc_segment_t *segment = os_provider->ipc_segments;
+    while (segment) {
+        os_ipc_window_t *window = segment->windows;
+        while (window) {
+            os_ipc_window_t *next = window->next;
+            if (utils_munmap(window->addr, window->size)) {
+                LOG_PERR("unmapping an IPC segment failed");
+            }
+            umf_ba_global_free(window);
+            window = next;
+        }
+
+        (void)utils_close_fd(segment->local_fd);
+
+        os_ipc_segment_t *next = segment->next;
+        umf_ba_global_free(segment);
+        segment = next;
+    }
+
+    os_provider->ipc_segments = NULL;
+}
+
 static umf_result_t os_open_ipc_handle(void *provider, void *providerIpcData,
                                        void **ptr) {
     if (provider == NULL || providerIpcData == NULL || ptr == NULL) {
@@ -1265,21 +1471,13 @@ static umf_result_t os_open_ipc_handle(void *provider, void *providerIpcData,
     umf_result_t ret = UMF_RESULT_SUCCESS;
     int fd;
 
-    if (os_ipc_data->shm_name_len) {
-        fd = utils_shm_open(os_ipc_data->shm_name);
-        if (fd <= 0) {
-            LOG_PERR("opening a shared memory file (%s) failed",
-                     os_ipc_data->shm_name);
-            return UMF_RESULT_ERROR_UNKNOWN;
-        }
-        (void)utils_shm_unlink(os_ipc_data->shm_name);
-    } else {
-        umf_result_t umf_result =
-            utils_duplicate_fd(os_ipc_data->pid, os_ipc_data->fd, &fd);
-        if (umf_result != UMF_RESULT_SUCCESS) {
-            LOG_PERR("duplicating file descriptor failed");
-            return umf_result;
-        }
+    if (os_provider->ipc_map_segments) {
+        return os_open_ipc_segment(os_provider, os_ipc_data, ptr);
+    }
+
+    ret = os_open_ipc_fd(os_ipc_data, &fd);
+    if (ret != UMF_RESULT_SUCCESS) {
+        return ret;
     }
 
     *ptr = utils_mmap(NULL, os_ipc_data->size, os_ipc_data->protection,
@@ -1307,6 +1505,12 @@ static umf_result_t os_close_ipc_handle(void *provider, void *ptr,
         return UMF_RESULT_ERROR_INVALID_ARGUMENT;
     }
 
+    // the mapping of an IPC segment is unmapped when the provider is destroyed
+    if (os_provider->ipc_map_segments &&
+        os_ipc_segment_contains(os_provider, ptr)) {
+        return UMF_RESULT_SUCCESS;
+    }
+
     errno = 0;
     int ret = utils_munmap(ptr, size);
     // ignore error when size == 0
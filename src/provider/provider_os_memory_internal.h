@@ -27,6 +27,28 @@
 extern "C" {
 #endif
 
+// A mapping of the beginning of a memory segment of a producer process.
+typedef struct os_ipc_window_t {
+    void *addr;
+    size_t size;
+    struct os_ipc_window_t *next;
+} os_ipc_window_t;
+
+// A memory segment (the file used for memory mappings) of a producer process
+// mapped by the consumer. When an IPC handle points beyond the current window,
+// a larger one is mapped. The previous windows are kept until the provider
+// is destroyed, because pointers to them can still be in use.
+// A segment is identified by the device and inode numbers of the file, which
+// (unlike the producer's pid and fd or a name of a shared memory file) cannot
+// refer to another file, as long as the segment keeps the file open.
+typedef struct os_ipc_segment_t {
+    uint64_t dev;             // device number of the file
+    uint64_t ino;             // inode number of the file
+    int local_fd;             // file descriptor in the current process
+    os_ipc_window_t *windows; // the current (the largest) one is the first
+    struct os_ipc_segment_t *next;
+} os_ipc_segment_t;
+
 typedef struct os_memory_provider_t {
     unsigned protection; // combination of OS-specific protection flags
     unsigned visibility; // memory visibility mode
@@ -38,6 +60,8 @@ typedef struct os_memory_provider_t {
     char shm_name[NAME_MAX];
 
     int fd;                // file descriptor for memory mapping
+    uint64_t fd_dev;       // device number of the file (for IPC handles)
+    uint64_t fd_ino;       // inode number of the file (for IPC handles)
     size_t size_fd;        // size of file used for memory mapping
     size_t max_size_fd;    // maximum size of file used for memory mapping
     utils_mutex_t lock_fd; // lock for updating file size
@@ -49,6 +73,12 @@ typedef struct os_memory_provider_t {
     // to mmap a specific part of a file.
     critnib *fd_offset_map;
 
+    // IPC handles are opened in mappings of whole memory segments
+    // of producers, if (in_params->ipc_map_segments == true)
+    bool ipc_map_segments;
+    os_ipc_segment_t *ipc_segments;
+    utils_mutex_t lock_ipc_segments; // lock for the list of segments
+
     // NUMA config
     umf_numa_mode_t mode;
     hwloc_bitmap_t *nodeset;
@@ -11,6 +11,7 @@
 #include "base_alloc_global.h"
 #include "critnib.h"
 #include "ipc_internal.h"
+#include "ravl.h"
 #include "utils_common.h"
 #include "utils_concurrency.h"
 #include "utils_log.h"
@@ -28,11 +29,236 @@
 typedef struct tracker_value_t {
     umf_memory_pool_handle_t pool;
     size_t size;
+
+    // address of the region (its key in the tracker) and links of the list
+    // of regions tracked by the same tracking provider
+    uintptr_t key;
+    struct tracker_value_t *prev;
+    struct tracker_value_t *next;
+
+    // the region is an extent of a tracking provider with coarse tracking
+    // holding n_allocs allocations (protected by the coarse lock of
+    // the provider)
+    bool coarse;
+    size_t n_allocs;
 } tracker_value_t;
 
-static umf_result_t umfMemoryTrackerAdd(umf_memory_tracker_handle_t hTracker,
-                                        umf_memory_pool_handle_t pool,
-                                        const void *ptr, size_t size) {
+// List of regions tracked by a single tracking provider, so that regions of
+// a pool can be removed from the tracker without searching the whole tracker.
+// A provider keeps one list per map of the tracker (indexed like the maps),
+// so that regions of different shards are linked under different locks.
+typedef struct tracker_region_list_t {
+    utils_mutex_t lock;
+    tracker_value_t *head;
+} tracker_region_list_t;
+
+// Per-thread direct-mapped cache of recent results of
+// umfMemoryTrackerGetAllocInfo(), indexed by the page of the looked up pointer.
+// Entries are valid only as long as no region was removed from (or resized in)
+// the map of the tracker holding the cached region since they were filled,
+// which is checked with the epoch of that map.
+#define TRACKER_CACHE_SIZE 16
+#define TRACKER_CACHE_PAGE_SHIFT 12
+
+typedef struct tracker_cache_entry_t {
+    uint64_t epoch;
+    size_t map; // index of the map holding the region
+    uintptr_t base;
+    size_t size; // 0 in zero-initialized (invalid) entries
+    umf_memory_pool_handle_t pool;
+    bool coarse;
+} tracker_cache_entry_t;
+
+// Incremented every time a region of the given map is removed or changed.
+// Each epoch takes its own cache line, so that frees of regions in different
+// shards don't contend on it.
+typedef struct tracker_epoch_t {
+    uint64_t value;
+    char padding[64 - sizeof(uint64_t)];
+} tracker_epoch_t;
+
+static tracker_epoch_t TRACKER_EPOCHS[TRACKER_NUM_SHARDS + 1];
+
+static __TLS tracker_cache_entry_t TLS_tracker_cache[TRACKER_CACHE_SIZE];
+
+static inline uint64_t tracker_cache_epoch(size_t map) {
+    uint64_t epoch;
+    utils_atomic_load_acquire(&TRACKER_EPOCHS[map].value, &epoch);
+    return epoch;
+}
+
+static inline void tracker_cache_invalidate(size_t map) {
+    utils_atomic_increment(&TRACKER_EPOCHS[map].value);
+}
+
+static inline void tracker_cache_invalidate_all(void) {
+    for (size_t m = 0; m <= TRACKER_NUM_SHARDS; m++) {
+        tracker_cache_invalidate(m);
+    }
+}
+
+static inline tracker_cache_entry_t *tracker_cache_entry(const void *ptr) {
+    size_t idx = ((uintptr_t)ptr >> TRACKER_CACHE_PAGE_SHIFT) %
+                 TRACKER_CACHE_SIZE;
+    return &TLS_tracker_cache[idx];
+}
+
+// index of the map of the tracker that holds the region [key, key + size)
+static inline size_t tracker_map_index(uintptr_t key, size_t size) {
+    uintptr_t first = key >> TRACKER_SHARD_SHIFT;
+    uintptr_t last = (key + (size ? size - 1 : 0)) >> TRACKER_SHARD_SHIFT;
+    if (first != last) {
+        return TRACKER_NUM_SHARDS;
+    }
+
+    return first % TRACKER_NUM_SHARDS;
+}
+
+// the list of the given provider's regions holding the region of value
+static inline tracker_region_list_t *
+tracker_region_list(tracker_region_list_t *regions, tracker_value_t *value) {
+    return &regions[tracker_map_index(value->key, value->size)];
+}
+
+static void tracker_region_list_link(tracker_region_list_t *regions,
+                                     tracker_value_t *value) {
+    tracker_region_list_t *list = tracker_region_list(regions, value);
+    utils_mutex_lock(&list->lock);
+    value->prev = NULL;
+    value->next = list->head;
+    if (list->head) {
+        list->head->prev = value;
+    }
+    list->head = value;
+    utils_mutex_unlock(&list->lock);
+}
+
+static void tracker_region_list_unlink(tracker_region_list_t *regions,
+                                       tracker_value_t *value) {
+    tracker_region_list_t *list = tracker_region_list(regions, value);
+    utils_mutex_lock(&list->lock);
+    if (value->prev) {
+        value->prev->next = value->next;
+    } else {
+        list->head = value->next;
+    }
+    if (value->next) {
+        value->next->prev = value->prev;
+    }
+    utils_mutex_unlock(&list->lock);
+}
+
+static inline critnib *tracker_map(umf_memory_tracker_handle_t hTracker,
+                                   uintptr_t key, size_t size) {
+    return hTracker->maps[tracker_map_index(key, size)];
+}
+
+static inline critnib *tracker_shard(umf_memory_tracker_handle_t hTracker,
+                                     uintptr_t key) {
+    return hTracker->maps[(key >> TRACKER_SHARD_SHIFT) % TRACKER_NUM_SHARDS];
+}
+
+static inline critnib *
+tracker_crossing_map(umf_memory_tracker_handle_t hTracker) {
+    return hTracker->maps[TRACKER_NUM_SHARDS];
+}
+
+// value of the region starting at the given address
+static tracker_value_t *tracker_get(umf_memory_tracker_handle_t hTracker,
+                                    uintptr_t key) {
+    tracker_value_t *value = critnib_get(tracker_shard(hTracker, key), key);
+    if (!value) {
+        value = critnib_get(tracker_crossing_map(hTracker), key);
+    }
+
+    return value;
+}
+
+// value of the region containing the given address
+static tracker_value_t *tracker_find(umf_memory_tracker_handle_t hTracker,
+                                     uintptr_t addr) {
+    // a region containing addr either starts in the granule of addr
+    // (and it is in its shard) or crosses a granule boundary
+    uintptr_t rkey;
+    tracker_value_t *rvalue;
+    int found = critnib_find(tracker_shard(hTracker, addr), addr, FIND_LE,
+                             (void *)&rkey, (void **)&rvalue);
+    if (!found || addr >= rkey + rvalue->size) {
+        found = critnib_find(tracker_crossing_map(hTracker), addr, FIND_LE,
+                             (void *)&rkey, (void **)&rvalue);
+    }
+    if (!found || addr >= rkey + rvalue->size) {
+        return NULL;
+    }
+
+    return rvalue;
+}
+
+// The value of a region is replaced by one of a different size (with the
+// same key) in two steps, so that everything that can fail is done before
+// the region is changed in the upstream provider.
+// tracker_replace_prepare() inserts the new value if it belongs to another map
+// than the old one. Returns 0 or an error of critnib_insert().
+static int tracker_replace_prepare(umf_memory_tracker_handle_t hTracker,
+                                   tracker_value_t *old_value,
+                                   tracker_value_t *new_value) {
+    assert(old_value->key == new_value->key);
+
+    critnib *old_map = tracker_map(hTracker, old_value->key, old_value->size);
+    critnib *new_map = tracker_map(hTracker, new_value->key, new_value->size);
+
+    if (old_map == new_map) {
+        // the value is updated in place by tracker_replace_commit()
+        return 0;
+    }
+
+    // insert before removing, so that the region is always found
+    return critnib_insert(new_map, new_value->key, new_value, 0);
+}
+
+// Make the prepared new value the only value of the region. Cannot fail.
+static void tracker_replace_commit(umf_memory_tracker_handle_t hTracker,
+                                   tracker_value_t *old_value,
+                                   tracker_value_t *new_value) {
+    critnib *old_map = tracker_map(hTracker, old_value->key, old_value->size);
+    critnib *new_map = tracker_map(hTracker, new_value->key, new_value->size);
+
+    if (old_map == new_map) {
+        // this cannot fail since the element exists (nothing to allocate)
+        int ret = critnib_insert(new_map, new_value->key, new_value,
+                                 1 /* update */);
+        assert(ret == 0);
+        (void)ret;
+        return;
+    }
+
+    void *removed = critnib_remove(old_map, old_value->key);
+    assert(removed == old_value);
+    (void)removed;
+}
+
+// Revert tracker_replace_prepare(), leaving the old value in place.
+static void tracker_replace_cancel(umf_memory_tracker_handle_t hTracker,
+                                   tracker_value_t *old_value,
+                                   tracker_value_t *new_value) {
+    critnib *old_map = tracker_map(hTracker, old_value->key, old_value->size);
+    critnib *new_map = tracker_map(hTracker, new_value->key, new_value->size);
+
+    if (old_map == new_map) {
+        return;
+    }
+
+    void *removed = critnib_remove(new_map, new_value->key);
+    assert(removed == new_value);
+    (void)removed;
+}
+
+static umf_result_t tracker_add_value(umf_memory_tracker_handle_t hTracker,
+                                      tracker_region_list_t *regions,
+                                      umf_memory_pool_handle_t pool,
+                                      const void *ptr, size_t size,
+                                      bool coarse,
+                                      tracker_value_t **pValue) {
     assert(ptr);
 
     tracker_value_t *value = umf_ba_alloc(hTracker->tracker_allocator);
@@ -44,12 +270,20 @@ static umf_result_t umfMemoryTrackerAdd(umf_memory_tracker_handle_t hTracker,
 
     value->pool = pool;
     value->size = size;
+    value->key = (uintptr_t)ptr;
+    value->coarse = coarse;
+    value->n_allocs = 0;
 
-    int ret = critnib_insert(hTracker->map, (uintptr_t)ptr, value, 0);
+    int ret = critnib_insert(tracker_map(hTracker, (uintptr_t)ptr, size),
+                             (uintptr_t)ptr, value, 0);
 
     if (ret == 0) {
+        tracker_region_list_link(regions, value);
         LOG_DEBUG("memory region is added, tracker=%p, ptr=%p, size=%zu",
                   (void *)hTracker, ptr, size);
+        if (pValue) {
+            *pValue = value;
+        }
         return UMF_RESULT_SUCCESS;
     }
 
@@ -65,7 +299,15 @@ static umf_result_t umfMemoryTrackerAdd(umf_memory_tracker_handle_t hTracker,
     return UMF_RESULT_ERROR_UNKNOWN;
 }
 
+static umf_result_t umfMemoryTrackerAdd(umf_memory_tracker_handle_t hTracker,
+                                        tracker_region_list_t *regions,
+                                        umf_memory_pool_handle_t pool,
+                                        const void *ptr, size_t size) {
+    return tracker_add_value(hTracker, regions, pool, ptr, size, false, NULL);
+}
+
 static umf_result_t umfMemoryTrackerRemove(umf_memory_tracker_handle_t hTracker,
+                                           tracker_region_list_t *regions,
                                            const void *ptr) {
     assert(ptr);
 
@@ -74,13 +316,20 @@ static umf_result_t umfMemoryTrackerRemove(umf_memory_tracker_handle_t hTracker,
     // Every umfMemoryTrackerAdd(..., ptr, ...) should have a corresponding
     // umfMemoryTrackerRemove call with the same ptr value.
 
-    void *value = critnib_remove(hTracker->map, (uintptr_t)ptr);
+    void *value = critnib_remove(tracker_shard(hTracker, (uintptr_t)ptr),
+                                 (uintptr_t)ptr);
+    if (!value) {
+        value = critnib_remove(tracker_crossing_map(hTracker), (uintptr_t)ptr);
+    }
     if (!value) {
         LOG_ERR("pointer %p not found in the map", ptr);
         return UMF_RESULT_ERROR_UNKNOWN;
     }
 
     tracker_value_t *v = value;
+    tracker_cache_invalidate(tracker_map_index(v->key, v->size));
+
+    tracker_region_list_unlink(regions, v);
 
     LOG_DEBUG("memory region removed: tracker=%p, ptr=%p, size=%zu",
               (void *)hTracker, ptr, v->size);
@@ -91,7 +340,7 @@ static umf_result_t umfMemoryTrackerRemove(umf_memory_tracker_handle_t hTracker,
 }
 
 umf_memory_pool_handle_t umfMemoryTrackerGetPool(const void *ptr) {
-    umf_alloc_info_t allocInfo = {NULL, 0, NULL};
+    umf_alloc_info_t allocInfo = {NULL, 0, NULL, false};
     umf_result_t ret = umfMemoryTrackerGetAllocInfo(ptr, &allocInfo);
     if (ret != UMF_RESULT_SUCCESS) {
         return NULL;
@@ -110,25 +359,50 @@ umf_result_t umfMemoryTrackerGetAllocInfo(const void *ptr,
         return UMF_RESULT_ERROR_NOT_SUPPORTED;
     }
 
-    if (TRACKER->map == NULL) {
+    if (TRACKER->maps[0] == NULL) {
         LOG_ERR("tracker's map is not created");
         return UMF_RESULT_ERROR_NOT_SUPPORTED;
     }
 
-    uintptr_t rkey;
-    tracker_value_t *rvalue;
-    int found = critnib_find(TRACKER->map, (uintptr_t)ptr, FIND_LE,
-                             (void *)&rkey, (void **)&rvalue);
-    if (!found || (uintptr_t)ptr >= rkey + rvalue->size) {
+    tracker_cache_entry_t *entry = tracker_cache_entry(ptr);
+    if ((uintptr_t)ptr >= entry->base &&
+        (uintptr_t)ptr - entry->base < entry->size &&
+        entry->epoch == tracker_cache_epoch(entry->map)) {
+        pAllocInfo->base = (void *)entry->base;
+        pAllocInfo->baseSize = entry->size;
+        pAllocInfo->pool = entry->pool;
+        pAllocInfo->coarse = entry->coarse;
+        return UMF_RESULT_SUCCESS;
+    }
+
+    // The epochs of both maps the region can be found in have to be read
+    // before the lookup, so that a region removed in the meantime is cached
+    // with an already outdated epoch.
+    size_t shard = ((uintptr_t)ptr >> TRACKER_SHARD_SHIFT) % TRACKER_NUM_SHARDS;
+    uint64_t shard_epoch = tracker_cache_epoch(shard);
+    uint64_t crossing_epoch = tracker_cache_epoch(TRACKER_NUM_SHARDS);
+
+    tracker_value_t *rvalue = tracker_find(TRACKER, (uintptr_t)ptr);
+    if (!rvalue) {
         LOG_WARN("pointer %p not found in the "
                  "tracker, TRACKER=%p",
                  ptr, (void *)TRACKER);
         return UMF_RESULT_ERROR_INVALID_ARGUMENT;
     }
 
-    pAllocInfo->base = (void *)rkey;
+    pAllocInfo->base = (void *)rvalue->key;
     pAllocInfo->baseSize = rvalue->size;
     pAllocInfo->pool = rvalue->pool;
+    pAllocInfo->coarse = rvalue->coarse;
+
+    // values are never changed in place, so the map is known from the value
+    entry->map = tracker_map_index(rvalue->key, rvalue->size);
+    entry->epoch =
+        entry->map == TRACKER_NUM_SHARDS ? crossing_epoch : shard_epoch;
+    entry->base = rvalue->key;
+    entry->size = rvalue->size;
+    entry->pool = rvalue->pool;
+    entry->coarse = rvalue->coarse;
 
     return UMF_RESULT_SUCCESS;
 }
@@ -137,22 +411,184 @@ umf_result_t umfMemoryTrackerGetAllocInfo(const void *ptr,
 // providerIpcData is a Flexible Array Member because its size varies
 // depending on the provider.
 typedef struct ipc_cache_value_t {
+    // base address of the allocation and links of the LRU list
+    uintptr_t key;
+    struct ipc_cache_value_t *prev;
+    struct ipc_cache_value_t *next;
+
+    uint64_t generation; // written to all IPC handles of the allocation
     uint64_t ipcDataSize;
     char providerIpcData[];
 } ipc_cache_value_t;
 
+// Generation of IPC handles, incremented every time a base allocation
+// is inserted into an IPC cache. Generation 0 is never used.
+static uint64_t IPC_GENERATION = 0;
+
+static umf_ipc_data_t *getUmfIpcData(void *providerIpcData) {
+    // This is hack to get size of memory pointed by IPC handle.
+    // tracking memory provider gets only provider-specific data
+    // pointed by providerIpcData, but the size of allocation tracked
+    // by umf_ipc_data_t. We use this trick to get pointer to
+    // umf_ipc_data_t data because the providerIpcData is
+    // the Flexible Array Member of umf_ipc_data_t.
+    return (umf_ipc_data_t *)((uint8_t *)providerIpcData -
+                              sizeof(umf_ipc_data_t));
+}
+
+// Identity of a base allocation exported by another process:
+// its IPC handle without the offset of the pointer in the allocation.
+typedef struct ipc_opened_key_t {
+    int pid;
+    uint64_t generation;
+    size_t baseSize;
+    size_t ipcDataSize;
+    const void *providerIpcData;
+} ipc_opened_key_t;
+
+// Cache entry of an IPC handle opened in the pool (consumer side).
+// The mapping is shared by all opens of the same base allocation and
+// counted; mappings which are not used anymore are kept in the LRU list.
+typedef struct ipc_opened_value_t {
+    ipc_opened_key_t key; // has to be the first member (see ipcOpenedCompare)
+    void *ptr;
+    size_t refcount;
+    struct ipc_opened_value_t *prev;
+    struct ipc_opened_value_t *next;
+    char providerIpcData[];
+} ipc_opened_value_t;
+
+// default number of unused mappings kept in the cache of opened IPC handles
+#define IPC_OPENED_CACHE_MAX_UNUSED 64
+
 typedef struct umf_tracking_memory_provider_t {
     umf_memory_provider_handle_t hUpstream;
     umf_memory_tracker_handle_t hTracker;
     umf_memory_pool_handle_t pool;
     critnib *ipcCache;
 
+    // LRU list of entries of ipcCache (the most recently used first).
+    // The least recently used entries are evicted when there are more than
+    // ipcCacheCapacity of them. The cache is modified and looked up under
+    // ipcCacheLock, because entries are evicted concurrently with lookups.
+    utils_mutex_t ipcCacheLock;
+    ipc_cache_value_t *ipcCacheHead;
+    ipc_cache_value_t *ipcCacheTail;
+    size_t ipcCacheCount;
+    size_t ipcCacheCapacity;
+    umf_ipc_cache_stats_t ipcCacheStats;
+
+    // regions added to the tracker by this provider, one list per map
+    tracker_region_list_t regions[TRACKER_NUM_SHARDS + 1];
+
     // the upstream provider does not support the free() operation
     bool upstreamDoesNotFree;
+
+    // Coarse tracking: allocations of up to coarseMaxSize bytes are carved
+    // from extents of coarseExtentSize bytes allocated from the upstream
+    // provider and only the extents are added to the tracker. Allocations are
+    // taken from the current extent (coarseExtent) at coarseOffset and aligned
+    // to coarsePageSize, so that they can be purged independently. An extent
+    // is returned to the upstream provider when its last allocation is freed
+    // and it is not the current one.
+    bool coarse;
+    utils_mutex_t coarseLock;
+    size_t coarseExtentSize;
+    size_t coarseMaxSize;
+    size_t coarsePageSize;
+    tracker_value_t *coarseExtent;
+    size_t coarseOffset;
+
+    // Cache of opened IPC handles: the tree finds the entry of a handle,
+    // the critnib finds it by the mapped address on close. Entries with
+    // refcount 0 are linked in the LRU list (the most recently used first)
+    // and the least recently used ones are closed when there are more than
+    // ipcOpenedMaxUnused of them.
+    utils_mutex_t ipcOpenedLock;
+    struct ravl *ipcOpened;
+    critnib *ipcOpenedPtrs;
+    ipc_opened_value_t *ipcUnusedHead;
+    ipc_opened_value_t *ipcUnusedTail;
+    size_t ipcUnusedCount;
+    size_t ipcOpenedMaxUnused;
+    umf_ipc_cache_stats_t ipcOpenedStats;
 } umf_tracking_memory_provider_t;
 
 typedef struct umf_tracking_memory_provider_t umf_tracking_memory_provider_t;
 
+// size of extents of the coarse tracking (rounded up to the page size
+// recommended by the upstream provider)
+#define COARSE_EXTENT_SIZE (2 * 1024 * 1024)
+
+static umf_result_t trackingFreeRegion(umf_tracking_memory_provider_t *p,
+                                       void *ptr, size_t size);
+
+// allocate memory from the current extent or from a new one
+static umf_result_t trackingAllocCoarse(umf_tracking_memory_provider_t *p,
+                                        size_t size, size_t alignment,
+                                        void **ptr) {
+    tracker_value_t *empty = NULL;
+    umf_result_t ret = UMF_RESULT_SUCCESS;
+
+    if (alignment < p->coarsePageSize) {
+        alignment = p->coarsePageSize;
+    }
+    size = ALIGN_UP(size, p->coarsePageSize);
+
+    utils_mutex_lock(&p->coarseLock);
+
+    tracker_value_t *extent = p->coarseExtent;
+    uintptr_t start = 0;
+    if (extent) {
+        start = ALIGN_UP(extent->key + p->coarseOffset, alignment);
+    }
+
+    if (!extent || start + size > extent->key + extent->size) {
+        void *base = NULL;
+        ret = umfMemoryProviderAlloc(p->hUpstream, p->coarseExtentSize, 0,
+                                     &base);
+        if (ret != UMF_RESULT_SUCCESS || !base) {
+            goto out;
+        }
+
+        ret = tracker_add_value(p->hTracker, p->regions, p->pool, base,
+                                p->coarseExtentSize, true, &extent);
+        if (ret != UMF_RESULT_SUCCESS) {
+            LOG_ERR("failed to add an extent to the tracker, ptr = %p, size "
+                    "= %zu, ret = %d",
+                    base, p->coarseExtentSize, ret);
+            if (umfMemoryProviderFree(p->hUpstream, base,
+                                      p->coarseExtentSize)) {
+                LOG_ERR("upstream provider failed to free the extent");
+            }
+            goto out;
+        }
+
+        // the previous extent is released here if it is empty,
+        // otherwise by the free of its last allocation
+        // (upstream providers without free() keep their extents)
+        if (p->coarseExtent && p->coarseExtent->n_allocs == 0 &&
+            !p->upstreamDoesNotFree) {
+            empty = p->coarseExtent;
+        }
+        p->coarseExtent = extent;
+        start = ALIGN_UP(extent->key, alignment);
+    }
+
+    extent->n_allocs++;
+    p->coarseOffset = start + size - extent->key;
+    *ptr = (void *)start;
+
+out:
+    utils_mutex_unlock(&p->coarseLock);
+
+    if (empty) {
+        (void)trackingFreeRegion(p, (void *)empty->key, empty->size);
+    }
+
+    return ret;
+}
+
 static umf_result_t trackingAlloc(void *hProvider, size_t size,
                                   size_t alignment, void **ptr) {
     umf_tracking_memory_provider_t *p =
@@ -161,12 +597,18 @@ static umf_result_t trackingAlloc(void *hProvider, size_t size,
 
     assert(p->hUpstream);
 
+    if (p->coarse && size <= p->coarseMaxSize &&
+        alignment <= p->coarseMaxSize) {
+        return trackingAllocCoarse(p, size, alignment, ptr);
+    }
+
     ret = umfMemoryProviderAlloc(p->hUpstream, size, alignment, ptr);
     if (ret != UMF_RESULT_SUCCESS || !*ptr) {
         return ret;
     }
 
-    umf_result_t ret2 = umfMemoryTrackerAdd(p->hTracker, p->pool, *ptr, size);
+    umf_result_t ret2 =
+        umfMemoryTrackerAdd(p->hTracker, p->regions, p->pool, *ptr, size);
     if (ret2 != UMF_RESULT_SUCCESS) {
         LOG_ERR("failed to add allocated region to the tracker, ptr = %p, size "
                 "= %zu, ret = %d",
@@ -176,6 +618,22 @@ static umf_result_t trackingAlloc(void *hProvider, size_t size,
     return ret;
 }
 
+// Returns the extent containing ptr if it is an allocation carved from
+// an extent of the given provider, NULL otherwise.
+static tracker_value_t *
+coarse_extent_of(umf_tracking_memory_provider_t *provider, const void *ptr) {
+    if (!provider->coarse) {
+        return NULL;
+    }
+
+    tracker_value_t *value = tracker_find(provider->hTracker, (uintptr_t)ptr);
+    if (!value || !value->coarse) {
+        return NULL;
+    }
+
+    return value;
+}
+
 static umf_result_t trackingAllocationSplit(void *hProvider, void *ptr,
                                             size_t totalSize,
                                             size_t firstSize) {
@@ -183,6 +641,19 @@ static umf_result_t trackingAllocationSplit(void *hProvider, void *ptr,
     umf_tracking_memory_provider_t *provider =
         (umf_tracking_memory_provider_t *)hProvider;
 
+    // allocations carved from an extent are only counted
+    tracker_value_t *extent = coarse_extent_of(provider, ptr);
+    if (extent) {
+        ret = umfMemoryProviderAllocationSplit(provider->hUpstream, ptr,
+                                               totalSize, firstSize);
+        if (ret == UMF_RESULT_SUCCESS) {
+            utils_mutex_lock(&provider->coarseLock);
+            extent->n_allocs++;
+            utils_mutex_unlock(&provider->coarseLock);
+        }
+        return ret;
+    }
+
     tracker_value_t *splitValue =
         umf_ba_alloc(provider->hTracker->tracker_allocator);
     if (!splitValue) {
@@ -191,14 +662,16 @@ static umf_result_t trackingAllocationSplit(void *hProvider, void *ptr,
 
     splitValue->pool = provider->pool;
     splitValue->size = firstSize;
+    splitValue->key = (uintptr_t)ptr;
+    splitValue->coarse = false;
+    splitValue->n_allocs = 0;
 
     int r = utils_mutex_lock(&provider->hTracker->splitMergeMutex);
     if (r) {
         goto err_lock;
     }
 
-    tracker_value_t *value =
-        (tracker_value_t *)critnib_get(provider->hTracker->map, (uintptr_t)ptr);
+    tracker_value_t *value = tracker_get(provider->hTracker, (uintptr_t)ptr);
     if (!value) {
         LOG_ERR("region for split is not found in the tracker");
         ret = UMF_RESULT_ERROR_INVALID_ARGUMENT;
@@ -211,35 +684,49 @@ static umf_result_t trackingAllocationSplit(void *hProvider, void *ptr,
         goto err;
     }
 
-    ret = umfMemoryProviderAllocationSplit(provider->hUpstream, ptr, totalSize,
-                                           firstSize);
-    if (ret != UMF_RESULT_SUCCESS) {
-        LOG_ERR("upstream provider failed to split the region");
-        goto err;
-    }
-
     void *highPtr = (void *)(((uintptr_t)ptr) + firstSize);
     size_t secondSize = totalSize - firstSize;
 
+    // The tracker is updated before the upstream split, so that nothing can
+    // fail after it; the changes are reverted if the upstream split fails.
     // We'll have a duplicate entry for the range [highPtr, highValue->size] but this is fine,
     // the value is the same anyway and we forbid removing that range concurrently
-    ret = umfMemoryTrackerAdd(provider->hTracker, provider->pool, highPtr,
-                              secondSize);
+    ret = umfMemoryTrackerAdd(provider->hTracker, provider->regions,
+                              provider->pool, highPtr, secondSize);
     if (ret != UMF_RESULT_SUCCESS) {
         LOG_ERR("failed to add split region to the tracker, ptr = %p, size "
                 "= %zu, ret = %d",
                 highPtr, secondSize, ret);
-        // TODO: what now? should we rollback the split? This can only happen due to ENOMEM
-        // so it's unlikely but probably the best solution would be to try to preallocate everything
-        // (value and critnib nodes) before calling umfMemoryProviderAllocationSplit.
         goto err;
     }
 
-    int cret = critnib_insert(provider->hTracker->map, (uintptr_t)ptr,
-                              (void *)splitValue, 1 /* update */);
-    // this cannot fail since we know the element exists (nothing to allocate)
-    assert(cret == 0);
-    (void)cret;
+    int cret = tracker_replace_prepare(provider->hTracker, value, splitValue);
+    if (cret) {
+        LOG_ERR("failed to update split region in the tracker, ptr = %p, "
+                "size = %zu, ret = %d",
+                ptr, firstSize, cret);
+        umfMemoryTrackerRemove(provider->hTracker, provider->regions,
+                               highPtr);
+        ret = UMF_RESULT_ERROR_OUT_OF_HOST_MEMORY;
+        goto err;
+    }
+
+    ret = umfMemoryProviderAllocationSplit(provider->hUpstream, ptr, totalSize,
+                                           firstSize);
+    if (ret != UMF_RESULT_SUCCESS) {
+        LOG_ERR("upstream provider failed to split the region");
+        // leave the tracker as it was before the split
+        tracker_replace_cancel(provider->hTracker, value, splitValue);
+        umfMemoryTrackerRemove(provider->hTracker, provider->regions,
+                               highPtr);
+        goto err;
+    }
+
+    tracker_replace_commit(provider->hTracker, value, splitValue);
+    tracker_cache_invalidate(tracker_map_index(value->key, value->size));
+
+    tracker_region_list_unlink(provider->regions, value);
+    tracker_region_list_link(provider->regions, splitValue);
 
     // free the original value
     umf_ba_free(provider->hTracker->tracker_allocator, value);
@@ -260,6 +747,26 @@ static umf_result_t trackingAllocationMerge(void *hProvider, void *lowPtr,
     umf_tracking_memory_provider_t *provider =
         (umf_tracking_memory_provider_t *)hProvider;
 
+    // allocations carved from the same extent are only counted
+    tracker_value_t *lowExtent = coarse_extent_of(provider, lowPtr);
+    tracker_value_t *highExtent = coarse_extent_of(provider, highPtr);
+    if (lowExtent || highExtent) {
+        if (lowExtent != highExtent) {
+            LOG_ERR("cannot merge regions of different extents");
+            return UMF_RESULT_ERROR_INVALID_ARGUMENT;
+        }
+
+        ret = umfMemoryProviderAllocationMerge(provider->hUpstream, lowPtr,
+                                               highPtr, totalSize);
+        if (ret == UMF_RESULT_SUCCESS) {
+            utils_mutex_lock(&provider->coarseLock);
+            assert(lowExtent->n_allocs > 1);
+            lowExtent->n_allocs--;
+            utils_mutex_unlock(&provider->coarseLock);
+        }
+        return ret;
+    }
+
     tracker_value_t *mergedValue =
         umf_ba_alloc(provider->hTracker->tracker_allocator);
 
@@ -269,21 +776,24 @@ static umf_result_t trackingAllocationMerge(void *hProvider, void *lowPtr,
 
     mergedValue->pool = provider->pool;
     mergedValue->size = totalSize;
+    mergedValue->key = (uintptr_t)lowPtr;
+    mergedValue->coarse = false;
+    mergedValue->n_allocs = 0;
 
     int r = utils_mutex_lock(&provider->hTracker->splitMergeMutex);
     if (r) {
         goto err_lock;
     }
 
-    tracker_value_t *lowValue = (tracker_value_t *)critnib_get(
-        provider->hTracker->map, (uintptr_t)lowPtr);
+    tracker_value_t *lowValue =
+        tracker_get(provider->hTracker, (uintptr_t)lowPtr);
     if (!lowValue) {
         LOG_ERR("no left value");
         ret = UMF_RESULT_ERROR_INVALID_ARGUMENT;
         goto err;
     }
-    tracker_value_t *highValue = (tracker_value_t *)critnib_get(
-        provider->hTracker->map, (uintptr_t)highPtr);
+    tracker_value_t *highValue =
+        tracker_get(provider->hTracker, (uintptr_t)highPtr);
     if (!highValue) {
         LOG_ERR("no right value");
         ret = UMF_RESULT_ERROR_INVALID_ARGUMENT;
@@ -300,27 +810,44 @@ static umf_result_t trackingAllocationMerge(void *hProvider, void *lowPtr,
         goto err;
     }
 
+    // The merged value is inserted before the upstream merge, so that nothing
+    // can fail after it.
+    // We'll have a duplicate entry for the range [highPtr, highValue->size] but this is fine,
+    // the value is the same anyway and we forbid removing that range concurrently
+    int cret =
+        tracker_replace_prepare(provider->hTracker, lowValue, mergedValue);
+    if (cret) {
+        LOG_ERR("failed to update merged region in the tracker, ptr = %p, "
+                "size = %zu, ret = %d",
+                lowPtr, totalSize, cret);
+        ret = UMF_RESULT_ERROR_OUT_OF_HOST_MEMORY;
+        goto err;
+    }
+
     ret = umfMemoryProviderAllocationMerge(provider->hUpstream, lowPtr, highPtr,
                                            totalSize);
     if (ret != UMF_RESULT_SUCCESS) {
         LOG_ERR("upstream provider failed to merge regions");
+        tracker_replace_cancel(provider->hTracker, lowValue, mergedValue);
         goto err;
     }
 
-    // We'll have a duplicate entry for the range [highPtr, highValue->size] but this is fine,
-    // the value is the same anyway and we forbid removing that range concurrently
-    int cret = critnib_insert(provider->hTracker->map, (uintptr_t)lowPtr,
-                              (void *)mergedValue, 1 /* update */);
-    // this cannot fail since we know the element exists (nothing to allocate)
-    assert(cret == 0);
-    (void)cret;
+    tracker_replace_commit(provider->hTracker, lowValue, mergedValue);
+
+    tracker_cache_invalidate(tracker_map_index(lowValue->key, lowValue->size));
+    tracker_region_list_unlink(provider->regions, lowValue);
+    tracker_region_list_link(provider->regions, mergedValue);
 
     // free old value that we just replaced with mergedValue
     umf_ba_free(provider->hTracker->tracker_allocator, lowValue);
 
-    void *erasedhighValue =
-        critnib_remove(provider->hTracker->map, (uintptr_t)highPtr);
+    void *erasedhighValue = critnib_remove(
+        tracker_map(provider->hTracker, highValue->key, highValue->size),
+        (uintptr_t)highPtr);
     assert(erasedhighValue == highValue);
+    tracker_cache_invalidate(
+        tracker_map_index(highValue->key, highValue->size));
+    tracker_region_list_unlink(provider->regions, highValue);
 
     umf_ba_free(provider->hTracker->tracker_allocator, erasedhighValue);
 
@@ -335,18 +862,81 @@ err_lock:
     return ret;
 }
 
-static umf_result_t trackingFree(void *hProvider, void *ptr, size_t size) {
+static void ipcCacheLink(umf_tracking_memory_provider_t *p,
+                         ipc_cache_value_t *value) {
+    value->prev = NULL;
+    value->next = p->ipcCacheHead;
+    if (p->ipcCacheHead) {
+        p->ipcCacheHead->prev = value;
+    } else {
+        p->ipcCacheTail = value;
+    }
+    p->ipcCacheHead = value;
+    p->ipcCacheCount++;
+}
+
+static void ipcCacheUnlink(umf_tracking_memory_provider_t *p,
+                           ipc_cache_value_t *value) {
+    if (value->prev) {
+        value->prev->next = value->next;
+    } else {
+        p->ipcCacheHead = value->next;
+    }
+    if (value->next) {
+        value->next->prev = value->prev;
+    } else {
+        p->ipcCacheTail = value->prev;
+    }
+    p->ipcCacheCount--;
+}
+
+// Remove the least recently used entries from ipcCache, so that it holds
+// at most ipcCacheCapacity entries. Returns the list of removed entries
+// (linked by next), which have to be put with ipcCachePutEvicted() after
+// ipcCacheLock is released.
+static ipc_cache_value_t *ipcCacheEvict(umf_tracking_memory_provider_t *p) {
+    ipc_cache_value_t *evicted = NULL;
+    while (p->ipcCacheCount > p->ipcCacheCapacity) {
+        ipc_cache_value_t *value = p->ipcCacheTail;
+        ipcCacheUnlink(p, value);
+        void *removed = critnib_remove(p->ipcCache, value->key);
+        assert(removed == value);
+        (void)removed;
+        p->ipcCacheStats.evictions++;
+
+        value->next = evicted;
+        evicted = value;
+    }
+
+    return evicted;
+}
+
+static void ipcCachePutEvicted(umf_tracking_memory_provider_t *p,
+                               ipc_cache_value_t *evicted) {
+    while (evicted) {
+        ipc_cache_value_t *next = evicted->next;
+        if (umfMemoryProviderPutIPCHandle(p->hUpstream,
+                                          evicted->providerIpcData)) {
+            LOG_ERR("upstream provider failed to put IPC handle, ptr=%p",
+                    (void *)evicted->key);
+        }
+        umf_ba_global_free(evicted);
+        evicted = next;
+    }
+}
+
+// free a region tracked as a whole (an allocation or an extent)
+static umf_result_t trackingFreeRegion(umf_tracking_memory_provider_t *p,
+                                       void *ptr, size_t size) {
     umf_result_t ret;
     umf_result_t ret_remove = UMF_RESULT_ERROR_UNKNOWN;
-    umf_tracking_memory_provider_t *p =
-        (umf_tracking_memory_provider_t *)hProvider;
 
     // umfMemoryTrackerRemove should be called before umfMemoryProviderFree
     // to avoid a race condition. If the order would be different, other thread
     // could allocate the memory at address `ptr` before a call to umfMemoryTrackerRemove
     // resulting in inconsistent state.
     if (ptr) {
-        ret_remove = umfMemoryTrackerRemove(p->hTracker, ptr);
+        ret_remove = umfMemoryTrackerRemove(p->hTracker, p->regions, ptr);
         if (ret_remove != UMF_RESULT_SUCCESS) {
             // DO NOT return an error here, because the tracking provider
             // cannot change behaviour of the upstream provider.
@@ -356,7 +946,13 @@ static umf_result_t trackingFree(void *hProvider, void *ptr, size_t size) {
         }
     }
 
+    utils_mutex_lock(&p->ipcCacheLock);
     void *value = critnib_remove(p->ipcCache, (uintptr_t)ptr);
+    if (value) {
+        ipcCacheUnlink(p, (ipc_cache_value_t *)value);
+    }
+    utils_mutex_unlock(&p->ipcCacheLock);
+
     if (value) {
         ipc_cache_value_t *cache_value = (ipc_cache_value_t *)value;
         ret = umfMemoryProviderPutIPCHandle(p->hUpstream,
@@ -378,8 +974,8 @@ static umf_result_t trackingFree(void *hProvider, void *ptr, size_t size) {
             return ret;
         }
 
-        if (umfMemoryTrackerAdd(p->hTracker, p->pool, ptr, size) !=
-            UMF_RESULT_SUCCESS) {
+        if (umfMemoryTrackerAdd(p->hTracker, p->regions, p->pool, ptr,
+                                size) != UMF_RESULT_SUCCESS) {
             LOG_ERR(
                 "cannot add memory back to the tracker, ptr = %p, size = %zu",
                 ptr, size);
@@ -390,6 +986,81 @@ static umf_result_t trackingFree(void *hProvider, void *ptr, size_t size) {
     return ret;
 }
 
+static umf_result_t trackingFree(void *hProvider, void *ptr, size_t size) {
+    umf_tracking_memory_provider_t *p =
+        (umf_tracking_memory_provider_t *)hProvider;
+
+    tracker_value_t *extent = ptr ? coarse_extent_of(p, ptr) : NULL;
+    if (!extent) {
+        return trackingFreeRegion(p, ptr, size);
+    }
+
+    // The extent stays allocated while other allocations are carved from it,
+    // so the freed pages are purged to not keep them resident. That has to be
+    // done before the allocation is released, since its space can be taken
+    // again right after that.
+    if (size) {
+        (void)umfMemoryProviderPurgeForce(p->hUpstream, ptr,
+                                          ALIGN_UP(size, p->coarsePageSize));
+    }
+
+    utils_mutex_lock(&p->coarseLock);
+    assert(extent->n_allocs > 0);
+    extent->n_allocs--;
+    bool release = false;
+    if (extent->n_allocs == 0) {
+        if (extent == p->coarseExtent) {
+            // start over from the beginning of the current extent
+            p->coarseOffset = 0;
+        } else {
+            // upstream providers without free() keep their extents
+            release = !p->upstreamDoesNotFree;
+        }
+    }
+    utils_mutex_unlock(&p->coarseLock);
+
+    if (release) {
+        return trackingFreeRegion(p, (void *)extent->key, extent->size);
+    }
+
+    return UMF_RESULT_SUCCESS;
+}
+
+// set up the coarse tracking of the provider,
+// falls back to tracking every allocation if it cannot be used
+static void trackingInitializeCoarse(umf_tracking_memory_provider_t *p) {
+    size_t extentPageSize = 0;
+    size_t minPageSize = 0;
+    if (umfMemoryProviderGetRecommendedPageSize(
+            p->hUpstream, COARSE_EXTENT_SIZE, &extentPageSize) ||
+        umfMemoryProviderGetMinPageSize(p->hUpstream, NULL, &minPageSize) ||
+        !minPageSize || (minPageSize & (minPageSize - 1)) || !extentPageSize) {
+        LOG_WARN("cannot get page sizes of the upstream provider, "
+                 "coarse tracking is disabled");
+        p->coarse = false;
+        return;
+    }
+
+    if (!utils_mutex_init(&p->coarseLock)) {
+        LOG_WARN("cannot initialize a mutex, coarse tracking is disabled");
+        p->coarse = false;
+        return;
+    }
+
+    p->coarseExtentSize = (COARSE_EXTENT_SIZE + extentPageSize - 1) /
+                          extentPageSize * extentPageSize;
+    p->coarseMaxSize = p->coarseExtentSize / 4;
+    p->coarsePageSize = minPageSize;
+    p->coarseExtent = NULL;
+    p->coarseOffset = 0;
+
+    LOG_DEBUG("coarse tracking: extent size=%zu, page size=%zu",
+              p->coarseExtentSize, p->coarsePageSize);
+}
+
+static int ipcOpenedCompare(const void *lhs, const void *rhs);
+static void ipcOpenedCacheDestroy(umf_tracking_memory_provider_t *p);
+
 static umf_result_t trackingInitialize(void *params, void **ret) {
     umf_tracking_memory_provider_t *provider =
         umf_ba_global_alloc(sizeof(umf_tracking_memory_provider_t));
@@ -403,73 +1074,202 @@ static umf_result_t trackingInitialize(void *params, void **ret) {
         return UMF_RESULT_ERROR_INVALID_ARGUMENT;
     }
 
+    umf_result_t result = UMF_RESULT_ERROR_UNKNOWN;
+    size_t n_lists;
+    for (n_lists = 0; n_lists <= TRACKER_NUM_SHARDS; n_lists++) {
+        if (!utils_mutex_init(&provider->regions[n_lists].lock)) {
+            goto err_destroy_regions_lock;
+        }
+        provider->regions[n_lists].head = NULL;
+    }
+
+    if (!utils_mutex_init(&provider->ipcCacheLock)) {
+        goto err_destroy_regions_lock;
+    }
+    provider->ipcCacheHead = NULL;
+    provider->ipcCacheTail = NULL;
+    provider->ipcCacheCount = 0;
+    provider->ipcCacheCapacity = SIZE_MAX;
+    memset(&provider->ipcCacheStats, 0, sizeof(provider->ipcCacheStats));
+
+    if (!utils_mutex_init(&provider->ipcOpenedLock)) {
+        goto err_destroy_ipc_cache_lock;
+    }
+
+    provider->ipcOpened = ravl_new(ipcOpenedCompare);
+    provider->ipcOpenedPtrs = critnib_new();
+    if (!provider->ipcOpened || !provider->ipcOpenedPtrs) {
+        result = UMF_RESULT_ERROR_OUT_OF_HOST_MEMORY;
+        goto err_delete_opened_cache;
+    }
+    provider->ipcUnusedHead = NULL;
+    provider->ipcUnusedTail = NULL;
+    provider->ipcUnusedCount = 0;
+    provider->ipcOpenedMaxUnused = IPC_OPENED_CACHE_MAX_UNUSED;
+    memset(&provider->ipcOpenedStats, 0, sizeof(provider->ipcOpenedStats));
+
+    if (provider->coarse) {
+        trackingInitializeCoarse(provider);
+    }
+
     *ret = provider;
     return UMF_RESULT_SUCCESS;
+
+err_delete_opened_cache:
+    if (provider->ipcOpened) {
+        ravl_delete(provider->ipcOpened);
+    }
+    if (provider->ipcOpenedPtrs) {
+        critnib_delete(provider->ipcOpenedPtrs);
+    }
+    utils_mutex_destroy_not_free(&provider->ipcOpenedLock);
+err_destroy_ipc_cache_lock:
+    utils_mutex_destroy_not_free(&provider->ipcCacheLock);
+err_destroy_regions_lock:
+    while (n_lists--) {
+        utils_mutex_destroy_not_free(&provider->regions[n_lists].lock);
+    }
+    umf_ba_global_free(provider);
+    return result;
+}
+
+// number of regions removed from the tracker at once when it is cleared
+#define CLEAR_TRACKER_BATCH_SIZE 256
+
+// remove a batch of regions from one map of the tracker under a single
+// critnib write lock
+static void clear_tracker_batch(umf_memory_tracker_handle_t hTracker,
+                                size_t map, const uintptr_t *keys,
+                                size_t n) {
+    void *values[CLEAR_TRACKER_BATCH_SIZE];
+
+    assert(n <= CLEAR_TRACKER_BATCH_SIZE);
+
+    if (n == 0) {
+        return;
+    }
+
+    size_t n_removed =
+        critnib_remove_batch(hTracker->maps[map], keys, values, n);
+    assert(n_removed == n);
+    (void)n_removed;
+    tracker_cache_invalidate(map);
+
+    for (size_t i = 0; i < n; i++) {
+        umf_ba_free(hTracker->tracker_allocator, values[i]);
+    }
 }
 
 // TODO clearing the tracker is a temporary solution and should be removed.
 // The tracker should be cleared using the provider's free() operation.
 static void clear_tracker_for_the_pool(umf_memory_tracker_handle_t hTracker,
+                                       tracker_region_list_t *regions,
                                        umf_memory_pool_handle_t pool,
                                        bool upstreamDoesNotFree) {
-    uintptr_t rkey;
-    void *rvalue;
     size_t n_items = 0;
-    uintptr_t last_key = 0;
-
-    while (1 == critnib_find((critnib *)hTracker->map, last_key, FIND_G, &rkey,
-                             &rvalue)) {
-        tracker_value_t *value = (tracker_value_t *)rvalue;
-        if (value->pool != pool && pool != NULL) {
-            last_key = rkey;
-            continue;
+    uintptr_t keys[CLEAR_TRACKER_BATCH_SIZE];
+
+    // only the regions of this pool are visited, not the whole tracker;
+    // they are removed map by map, so that a batch is removed under a single
+    // lock (values are freed by the batch, after their next links are read)
+    for (size_t m = 0; m <= TRACKER_NUM_SHARDS; m++) {
+        utils_mutex_lock(&regions[m].lock);
+        tracker_value_t *list = regions[m].head;
+        regions[m].head = NULL;
+        utils_mutex_unlock(&regions[m].lock);
+
+        size_t n = 0;
+        for (tracker_value_t *v = list, *next; v; v = next) {
+            next = v->next;
+            keys[n++] = v->key;
+            if (n == CLEAR_TRACKER_BATCH_SIZE) {
+                clear_tracker_batch(hTracker, m, keys, n);
+                n_items += n;
+                n = 0;
+            }
         }
 
-        n_items++;
-
-        void *removed_value = critnib_remove(hTracker->map, rkey);
-        assert(removed_value == rvalue);
-        umf_ba_free(hTracker->tracker_allocator, removed_value);
-
-        last_key = rkey;
+        clear_tracker_batch(hTracker, m, keys, n);
+        n_items += n;
     }
 
 #ifndef NDEBUG
     // print error messages only if provider supports the free() operation
     if (n_items && !upstreamDoesNotFree) {
-        if (pool) {
-            LOG_ERR(
-                "tracking provider of pool %p is not empty! (%zu items left)",
+        LOG_ERR("tracking provider of pool %p is not empty! (%zu items left)",
                 (void *)pool, n_items);
-        } else {
-            LOG_ERR("tracking provider is not empty! (%zu items left)",
-                    n_items);
-        }
     }
 #else  /* DEBUG */
+    (void)pool;                // unused in DEBUG build
     (void)upstreamDoesNotFree; // unused in DEBUG build
     (void)n_items;             // unused in DEBUG build
 #endif /* DEBUG */
 }
 
 static void clear_tracker(umf_memory_tracker_handle_t hTracker) {
-    clear_tracker_for_the_pool(hTracker, NULL, false);
+    uintptr_t rkey;
+    size_t n_items = 0;
+    uintptr_t last_key = 0;
+    uintptr_t keys[CLEAR_TRACKER_BATCH_SIZE];
+
+    for (size_t m = 0; m <= TRACKER_NUM_SHARDS; m++) {
+        critnib *map = hTracker->maps[m];
+        last_key = 0;
+        while (1) {
+            size_t n = 0;
+            while (n < CLEAR_TRACKER_BATCH_SIZE &&
+                   1 == critnib_find(map, last_key, FIND_G, &rkey, NULL)) {
+                keys[n++] = rkey;
+                last_key = rkey;
+            }
+
+            if (n == 0) {
+                break;
+            }
+
+            clear_tracker_batch(hTracker, m, keys, n);
+            n_items += n;
+        }
+    }
+
+#ifndef NDEBUG
+    if (n_items) {
+        LOG_ERR("tracking provider is not empty! (%zu items left)", n_items);
+    }
+#else  /* DEBUG */
+    (void)n_items; // unused in DEBUG build
+#endif /* DEBUG */
 }
 
 static void trackingFinalize(void *provider) {
     umf_tracking_memory_provider_t *p =
         (umf_tracking_memory_provider_t *)provider;
 
+    if (p->coarse) {
+        // the IPC cache may still hold a handle of the current extent
+        tracker_value_t *extent = p->coarseExtent;
+        if (extent && extent->n_allocs == 0 && !p->upstreamDoesNotFree) {
+            (void)trackingFreeRegion(p, (void *)extent->key, extent->size);
+        }
+        utils_mutex_destroy_not_free(&p->coarseLock);
+    }
+
     critnib_delete(p->ipcCache);
+    utils_mutex_destroy_not_free(&p->ipcCacheLock);
+
+    ipcOpenedCacheDestroy(p);
 
     // Do not clear the tracker if we are running in the proxy library,
     // because it may need those resources till
     // the very end of exiting the application.
     if (!utils_is_running_in_proxy_lib()) {
-        clear_tracker_for_the_pool(p->hTracker, p->pool,
+        clear_tracker_for_the_pool(p->hTracker, p->regions, p->pool,
                                    p->upstreamDoesNotFree);
     }
 
+    for (size_t m = 0; m <= TRACKER_NUM_SHARDS; m++) {
+        utils_mutex_destroy_not_free(&p->regions[m].lock);
+    }
     umf_ba_global_free(provider);
 }
 
@@ -519,84 +1319,107 @@ static umf_result_t trackingGetIpcHandleSize(void *provider, size_t *size) {
     return umfMemoryProviderGetIPCHandleSize(p->hUpstream, size);
 }
 
+// copy the cached handle and mark it as the most recently used one,
+// has to be called with ipcCacheLock held
+static void ipcCacheUse(umf_tracking_memory_provider_t *p,
+                        ipc_cache_value_t *cache_value, void *providerIpcData) {
+    memcpy(providerIpcData, cache_value->providerIpcData,
+           cache_value->ipcDataSize);
+    getUmfIpcData(providerIpcData)->generation = cache_value->generation;
+    ipcCacheUnlink(p, cache_value);
+    ipcCacheLink(p, cache_value);
+}
+
 static umf_result_t trackingGetIpcHandle(void *provider, const void *ptr,
                                          size_t size, void *providerIpcData) {
     umf_tracking_memory_provider_t *p =
         (umf_tracking_memory_provider_t *)provider;
     umf_result_t ret = UMF_RESULT_SUCCESS;
     size_t ipcDataSize = 0;
-    int cached = 0;
-    do {
-        void *value = critnib_get(p->ipcCache, (uintptr_t)ptr);
-        if (value) { //cache hit
-            ipc_cache_value_t *cache_value = (ipc_cache_value_t *)value;
-            memcpy(providerIpcData, cache_value->providerIpcData,
-                   cache_value->ipcDataSize);
-            cached = 1;
-        } else {
-            ret = umfMemoryProviderGetIPCHandle(p->hUpstream, ptr, size,
-                                                providerIpcData);
-            if (ret != UMF_RESULT_SUCCESS) {
-                LOG_ERR("upstream provider failed to get IPC handle");
-                return ret;
-            }
 
-            ret = umfMemoryProviderGetIPCHandleSize(p->hUpstream, &ipcDataSize);
-            if (ret != UMF_RESULT_SUCCESS) {
-                LOG_ERR("upstream provider failed to get the size of IPC "
-                        "handle");
-                ret = umfMemoryProviderPutIPCHandle(p->hUpstream,
-                                                    providerIpcData);
-                if (ret != UMF_RESULT_SUCCESS) {
-                    LOG_ERR("upstream provider failed to put IPC handle");
-                }
-                return ret;
-            }
+    utils_mutex_lock(&p->ipcCacheLock);
 
-            size_t value_size = sizeof(ipc_cache_value_t) + ipcDataSize;
-            ipc_cache_value_t *cache_value = umf_ba_global_alloc(value_size);
-            if (!cache_value) {
-                LOG_ERR("failed to allocate cache_value");
-                ret = umfMemoryProviderPutIPCHandle(p->hUpstream,
-                                                    providerIpcData);
-                if (ret != UMF_RESULT_SUCCESS) {
-                    LOG_ERR("upstream provider failed to put IPC handle");
-                }
-                return UMF_RESULT_ERROR_OUT_OF_HOST_MEMORY;
-            }
+    ipc_cache_value_t *cache_value = critnib_get(p->ipcCache, (uintptr_t)ptr);
+    if (cache_value) { //cache hit
+        ipcCacheUse(p, cache_value, providerIpcData);
+        p->ipcCacheStats.hits++;
+        utils_mutex_unlock(&p->ipcCacheLock);
+        return UMF_RESULT_SUCCESS;
+    }
 
-            cache_value->ipcDataSize = ipcDataSize;
-            memcpy(cache_value->providerIpcData, providerIpcData, ipcDataSize);
-
-            int insRes = critnib_insert(p->ipcCache, (uintptr_t)ptr,
-                                        (void *)cache_value, 0 /*update*/);
-            if (insRes == 0) {
-                cached = 1;
-            } else {
-                // critnib_insert might fail in 2 cases:
-                // 1. Another thread created cache entry. So we need to
-                //    clean up allocated handle and try to read again from
-                //    the cache. Alternative approach could be insert empty
-                //    cache_value and only if insert succeed get actual IPC
-                //    handle and fill the cache_value structure under the lock.
-                //    But this case should be rare enough.
-                // 2. critnib failed to allocate memory internally. We need
-                //    to cleanup and return corresponding error.
-                umf_ba_global_free(cache_value);
-                ret = umfMemoryProviderPutIPCHandle(p->hUpstream,
-                                                    providerIpcData);
-                if (ret != UMF_RESULT_SUCCESS) {
-                    LOG_ERR("upstream provider failed to put IPC handle");
-                    return ret;
-                }
-                if (insRes == ENOMEM) {
-                    LOG_ERR("insert to IPC cache failed due to OOM");
-                    return UMF_RESULT_ERROR_OUT_OF_HOST_MEMORY;
-                }
-            }
+    p->ipcCacheStats.misses++;
+    utils_mutex_unlock(&p->ipcCacheLock);
+
+    // The handle is got from the upstream provider without the lock held,
+    // so that other exports don't wait for it. If another thread adds
+    // the handle of the same pointer in the meantime, its one is used.
+    ret = umfMemoryProviderGetIPCHandle(p->hUpstream, ptr, size,
+                                        providerIpcData);
+    if (ret != UMF_RESULT_SUCCESS) {
+        LOG_ERR("upstream provider failed to get IPC handle");
+        return ret;
+    }
+
+    ret = umfMemoryProviderGetIPCHandleSize(p->hUpstream, &ipcDataSize);
+    if (ret != UMF_RESULT_SUCCESS) {
+        LOG_ERR("upstream provider failed to get the size of IPC handle");
+        goto err_put_handle;
+    }
+
+    size_t value_size = sizeof(ipc_cache_value_t) + ipcDataSize;
+    cache_value = umf_ba_global_alloc(value_size);
+    if (!cache_value) {
+        LOG_ERR("failed to allocate cache_value");
+        ret = UMF_RESULT_ERROR_OUT_OF_HOST_MEMORY;
+        goto err_put_handle;
+    }
+
+    cache_value->key = (uintptr_t)ptr;
+    cache_value->generation = utils_atomic_increment(&IPC_GENERATION);
+    cache_value->ipcDataSize = ipcDataSize;
+    memcpy(cache_value->providerIpcData, providerIpcData, ipcDataSize);
+
+    utils_mutex_lock(&p->ipcCacheLock);
+
+    ipc_cache_value_t *other = critnib_get(p->ipcCache, (uintptr_t)ptr);
+    if (other) {
+        // another thread added the handle first, ours is put
+        ipcCacheUse(p, other, providerIpcData);
+        utils_mutex_unlock(&p->ipcCacheLock);
+        if (umfMemoryProviderPutIPCHandle(p->hUpstream,
+                                          cache_value->providerIpcData)) {
+            LOG_ERR("upstream provider failed to put IPC handle");
         }
-    } while (!cached);
+        umf_ba_global_free(cache_value);
+        return UMF_RESULT_SUCCESS;
+    }
+
+    // the entry cannot exist (the lock is held),
+    // so critnib_insert() can fail only due to OOM
+    int insRes = critnib_insert(p->ipcCache, (uintptr_t)ptr,
+                                (void *)cache_value, 0 /*update*/);
+    if (insRes) {
+        utils_mutex_unlock(&p->ipcCacheLock);
+        LOG_ERR("insert to IPC cache failed due to OOM");
+        umf_ba_global_free(cache_value);
+        ret = UMF_RESULT_ERROR_OUT_OF_HOST_MEMORY;
+        goto err_put_handle;
+    }
+
+    ipcCacheLink(p, cache_value);
+    ipc_cache_value_t *evicted = ipcCacheEvict(p);
+    getUmfIpcData(providerIpcData)->generation = cache_value->generation;
+
+    utils_mutex_unlock(&p->ipcCacheLock);
+
+    ipcCachePutEvicted(p, evicted);
+
+    return UMF_RESULT_SUCCESS;
 
+err_put_handle:
+    if (umfMemoryProviderPutIPCHandle(p->hUpstream, providerIpcData)) {
+        LOG_ERR("upstream provider failed to put IPC handle");
+    }
     return ret;
 }
 
@@ -609,58 +1432,118 @@ static umf_result_t trackingPutIpcHandle(void *provider,
     return UMF_RESULT_SUCCESS;
 }
 
-static size_t getDataSizeFromIpcHandle(const void *providerIpcData) {
-    // This is hack to get size of memory pointed by IPC handle.
-    // tracking memory provider gets only provider-specific data
-    // pointed by providerIpcData, but the size of allocation tracked
-    // by umf_ipc_data_t. We use this trick to get pointer to
-    // umf_ipc_data_t data because the providerIpcData is
-    // the Flexible Array Member of umf_ipc_data_t.
-    const umf_ipc_data_t *ipcUmfData =
-        (const umf_ipc_data_t *)((const uint8_t *)providerIpcData -
-                                 sizeof(umf_ipc_data_t));
-    return ipcUmfData->baseSize;
+static int ipcOpenedCompare(const void *lhs, const void *rhs) {
+    const ipc_opened_key_t *l = (const ipc_opened_key_t *)lhs;
+    const ipc_opened_key_t *r = (const ipc_opened_key_t *)rhs;
+
+    if (l->pid != r->pid) {
+        return l->pid < r->pid ? -1 : 1;
+    }
+    if (l->generation != r->generation) {
+        return l->generation < r->generation ? -1 : 1;
+    }
+    if (l->baseSize != r->baseSize) {
+        return l->baseSize < r->baseSize ? -1 : 1;
+    }
+    if (l->ipcDataSize != r->ipcDataSize) {
+        return l->ipcDataSize < r->ipcDataSize ? -1 : 1;
+    }
+
+    return memcmp(l->providerIpcData, r->providerIpcData, l->ipcDataSize);
 }
 
-static umf_result_t trackingOpenIpcHandle(void *provider, void *providerIpcData,
-                                          void **ptr) {
-    umf_tracking_memory_provider_t *p =
-        (umf_tracking_memory_provider_t *)provider;
-    umf_result_t ret = UMF_RESULT_SUCCESS;
+static void ipcUnusedLink(umf_tracking_memory_provider_t *p,
+                          ipc_opened_value_t *value) {
+    value->prev = NULL;
+    value->next = p->ipcUnusedHead;
+    if (p->ipcUnusedHead) {
+        p->ipcUnusedHead->prev = value;
+    } else {
+        p->ipcUnusedTail = value;
+    }
+    p->ipcUnusedHead = value;
+    p->ipcUnusedCount++;
+}
 
-    assert(p->hUpstream);
+static void ipcUnusedUnlink(umf_tracking_memory_provider_t *p,
+                            ipc_opened_value_t *value) {
+    if (value->prev) {
+        value->prev->next = value->next;
+    } else {
+        p->ipcUnusedHead = value->next;
+    }
+    if (value->next) {
+        value->next->prev = value->prev;
+    } else {
+        p->ipcUnusedTail = value->prev;
+    }
+    p->ipcUnusedCount--;
+}
 
-    ret = umfMemoryProviderOpenIPCHandle(p->hUpstream, providerIpcData, ptr);
-    if (ret != UMF_RESULT_SUCCESS) {
-        LOG_ERR("upstream provider failed to open IPC handle");
-        return ret;
+// remove the entry from the cache (but not from the LRU list)
+static void ipcOpenedRemove(umf_tracking_memory_provider_t *p,
+                            ipc_opened_value_t *value) {
+    // the entry is missing in ipcOpened only if re-keying it failed
+    struct ravl_node *node =
+        ravl_find(p->ipcOpened, &value->key, RAVL_PREDICATE_EQUAL);
+    if (node) {
+        assert(ravl_data(node) == value);
+        ravl_remove(p->ipcOpened, node);
+    }
+
+    void *removed = critnib_remove(p->ipcOpenedPtrs, (uintptr_t)value->ptr);
+    assert(removed == value);
+    (void)removed;
+    p->ipcOpenedStats.size--;
+}
+
+// Remove the least recently used unused entries from the cache, so that
+// at most ipcOpenedMaxUnused of them are kept. Returns the list of removed
+// entries (linked by next), which have to be closed with
+// ipcOpenedCloseEvicted() after ipcOpenedLock is released.
+static ipc_opened_value_t *ipcOpenedEvict(umf_tracking_memory_provider_t *p) {
+    ipc_opened_value_t *evicted = NULL;
+    while (p->ipcUnusedCount > p->ipcOpenedMaxUnused) {
+        ipc_opened_value_t *value = p->ipcUnusedTail;
+        ipcUnusedUnlink(p, value);
+        ipcOpenedRemove(p, value);
+        p->ipcOpenedStats.evictions++;
+
+        value->next = evicted;
+        evicted = value;
     }
-    size_t bufferSize = getDataSizeFromIpcHandle(providerIpcData);
-    ret = umfMemoryTrackerAdd(p->hTracker, p->pool, *ptr, bufferSize);
+
+    return evicted;
+}
+
+// add the mapping of an IPC handle opened in the upstream provider
+// to the tracker, closing it if that fails
+static umf_result_t trackIpcMapping(umf_tracking_memory_provider_t *p,
+                                    void *ptr, size_t bufferSize) {
+    umf_result_t ret =
+        umfMemoryTrackerAdd(p->hTracker, p->regions, p->pool, ptr, bufferSize);
     if (ret != UMF_RESULT_SUCCESS) {
         LOG_ERR("failed to add IPC region to the tracker, ptr=%p, size=%zu, "
                 "ret = %d",
-                *ptr, bufferSize, ret);
-        if (umfMemoryProviderCloseIPCHandle(p->hUpstream, *ptr, bufferSize)) {
+                ptr, bufferSize, ret);
+        if (umfMemoryProviderCloseIPCHandle(p->hUpstream, ptr, bufferSize)) {
             LOG_ERR("upstream provider failed to close IPC handle, ptr=%p, "
                     "size=%zu",
-                    *ptr, bufferSize);
+                    ptr, bufferSize);
         }
     }
     return ret;
 }
 
-static umf_result_t trackingCloseIpcHandle(void *provider, void *ptr,
-                                           size_t size) {
-    umf_tracking_memory_provider_t *p =
-        (umf_tracking_memory_provider_t *)provider;
-
+static umf_result_t closeIpcHandleUpstream(umf_tracking_memory_provider_t *p,
+                                           void *ptr, size_t size) {
     // umfMemoryTrackerRemove should be called before umfMemoryProviderCloseIPCHandle
     // to avoid a race condition. If the order would be different, other thread
     // could allocate the memory at address `ptr` before a call to umfMemoryTrackerRemove
     // resulting in inconsistent state.
     if (ptr) {
-        umf_result_t ret = umfMemoryTrackerRemove(p->hTracker, ptr);
+        umf_result_t ret =
+            umfMemoryTrackerRemove(p->hTracker, p->regions, ptr);
         if (ret != UMF_RESULT_SUCCESS) {
             // DO NOT return an error here, because the tracking provider
             // cannot change behaviour of the upstream provider.
@@ -672,6 +1555,245 @@ static umf_result_t trackingCloseIpcHandle(void *provider, void *ptr,
     return umfMemoryProviderCloseIPCHandle(p->hUpstream, ptr, size);
 }
 
+// Make the entry of a mapping shared by handles of the same region cached
+// under the key of the most recently opened handle, so that further opens
+// of that handle find it. Has to be called with ipcOpenedLock held.
+static void ipcOpenedRekey(umf_tracking_memory_provider_t *p,
+                           ipc_opened_value_t *value,
+                           const ipc_opened_key_t *key) {
+    struct ravl_node *node =
+        ravl_find(p->ipcOpened, &value->key, RAVL_PREDICATE_EQUAL);
+    if (node) {
+        ravl_remove(p->ipcOpened, node);
+    }
+
+    memcpy(value->providerIpcData, key->providerIpcData, key->ipcDataSize);
+    value->key.pid = key->pid;
+    value->key.generation = key->generation;
+
+    if (ravl_insert(p->ipcOpened, value)) {
+        // the entry can still be found by its pointer to be closed
+        LOG_WARN("failed to insert to the opened IPC handles cache");
+    }
+}
+
+// Take a reference to the cached mapping of the IPC handle of the given key
+// or return NULL if it is not cached. Has to be called with ipcOpenedLock held.
+static ipc_opened_value_t *ipcOpenedFind(umf_tracking_memory_provider_t *p,
+                                         const ipc_opened_key_t *key) {
+    struct ravl_node *node = ravl_find(p->ipcOpened, key, RAVL_PREDICATE_EQUAL);
+    if (!node) {
+        return NULL;
+    }
+
+    ipc_opened_value_t *value = ravl_data(node);
+    if (value->refcount++ == 0) {
+        ipcUnusedUnlink(p, value);
+    }
+    return value;
+}
+
+// Open the IPC handle or take a reference to the cached mapping of it.
+// *pValue is set to the cache entry of the mapping or to NULL if the mapping
+// could not be cached. The handle is opened in the upstream provider without
+// ipcOpenedLock held, so that opens of different handles do not wait for
+// each other's mappings; if the same handle is opened concurrently, only
+// the first mapping is cached and the other ones are closed.
+static umf_result_t ipcOpenedGet(umf_tracking_memory_provider_t *p,
+                                 void *providerIpcData, size_t ipcDataSize,
+                                 void **ptr, ipc_opened_value_t **pValue) {
+    const umf_ipc_data_t *ipcUmfData = getUmfIpcData(providerIpcData);
+    ipc_opened_key_t key = {ipcUmfData->pid, ipcUmfData->generation,
+                            ipcUmfData->baseSize, ipcDataSize,
+                            providerIpcData};
+
+    *pValue = NULL;
+
+    utils_mutex_lock(&p->ipcOpenedLock);
+    ipc_opened_value_t *value = ipcOpenedFind(p, &key);
+    if (value) {
+        p->ipcOpenedStats.hits++;
+    } else {
+        p->ipcOpenedStats.misses++;
+    }
+    utils_mutex_unlock(&p->ipcOpenedLock);
+
+    if (value) {
+        *ptr = value->ptr;
+        *pValue = value;
+        return UMF_RESULT_SUCCESS;
+    }
+
+    umf_result_t ret =
+        umfMemoryProviderOpenIPCHandle(p->hUpstream, providerIpcData, ptr);
+    if (ret != UMF_RESULT_SUCCESS) {
+        LOG_ERR("upstream provider failed to open IPC handle");
+        return ret;
+    }
+
+    utils_mutex_lock(&p->ipcOpenedLock);
+
+    value = ipcOpenedFind(p, &key);
+    if (value) {
+        // the handle was opened and cached by another thread meanwhile
+        utils_mutex_unlock(&p->ipcOpenedLock);
+        (void)umfMemoryProviderCloseIPCHandle(p->hUpstream, *ptr, key.baseSize);
+        *ptr = value->ptr;
+        *pValue = value;
+        return UMF_RESULT_SUCCESS;
+    }
+
+    // Providers opening IPC handles in mappings of whole segments return
+    // the same address for a region exported again by its producer (with
+    // a new generation), where the mapping of the old handle can be cached.
+    ipc_opened_value_t *old = critnib_get(p->ipcOpenedPtrs, (uintptr_t)*ptr);
+    if (old && old->refcount) {
+        // the mapping is shared with the old handle, which is still open
+        bool sameSize = old->key.baseSize == key.baseSize;
+        if (sameSize) {
+            old->refcount++;
+            ipcOpenedRekey(p, old, &key);
+        }
+        utils_mutex_unlock(&p->ipcOpenedLock);
+        (void)umfMemoryProviderCloseIPCHandle(p->hUpstream, *ptr, key.baseSize);
+        if (!sameSize) {
+            LOG_ERR("IPC handle is mapped at %p, which is in use by another "
+                    "handle of a different size",
+                    *ptr);
+            return UMF_RESULT_ERROR_INVALID_ARGUMENT;
+        }
+        *pValue = old;
+        return UMF_RESULT_SUCCESS;
+    }
+    if (old) {
+        // the unused mapping of the old handle is stale
+        ipcUnusedUnlink(p, old);
+        ipcOpenedRemove(p, old);
+        (void)closeIpcHandleUpstream(p, old->ptr, old->key.baseSize);
+        umf_ba_global_free(old);
+    }
+
+    ret = trackIpcMapping(p, *ptr, key.baseSize);
+    if (ret != UMF_RESULT_SUCCESS) {
+        utils_mutex_unlock(&p->ipcOpenedLock);
+        return ret;
+    }
+
+    // if the entry cannot be added, the mapping is just not cached
+    value = umf_ba_global_alloc(sizeof(ipc_opened_value_t) + ipcDataSize);
+    if (!value) {
+        utils_mutex_unlock(&p->ipcOpenedLock);
+        LOG_WARN("failed to allocate an entry of the opened IPC handles cache");
+        return UMF_RESULT_SUCCESS;
+    }
+
+    memcpy(value->providerIpcData, providerIpcData, ipcDataSize);
+    value->key = key;
+    value->key.providerIpcData = value->providerIpcData;
+    value->ptr = *ptr;
+    value->refcount = 1;
+
+    if (critnib_insert(p->ipcOpenedPtrs, (uintptr_t)*ptr, value, 0)) {
+        LOG_WARN("failed to insert to the opened IPC handles cache");
+        umf_ba_global_free(value);
+    } else if (ravl_insert(p->ipcOpened, value)) {
+        LOG_WARN("failed to insert to the opened IPC handles cache");
+        critnib_remove(p->ipcOpenedPtrs, (uintptr_t)*ptr);
+        umf_ba_global_free(value);
+    } else {
+        p->ipcOpenedStats.size++;
+        *pValue = value;
+    }
+
+    utils_mutex_unlock(&p->ipcOpenedLock);
+
+    return UMF_RESULT_SUCCESS;
+}
+
+static umf_result_t trackingOpenIpcHandle(void *provider, void *providerIpcData,
+                                          void **ptr) {
+    umf_tracking_memory_provider_t *p =
+        (umf_tracking_memory_provider_t *)provider;
+    umf_result_t ret = UMF_RESULT_SUCCESS;
+
+    assert(p->hUpstream);
+
+    size_t ipcDataSize = 0;
+    ret = umfMemoryProviderGetIPCHandleSize(p->hUpstream, &ipcDataSize);
+    if (ret != UMF_RESULT_SUCCESS) {
+        LOG_ERR("upstream provider failed to get the size of IPC handle");
+        return ret;
+    }
+
+    ipc_opened_value_t *value;
+    return ipcOpenedGet(p, providerIpcData, ipcDataSize, ptr, &value);
+}
+
+static umf_result_t trackingCloseIpcHandle(void *provider, void *ptr,
+                                           size_t size) {
+    umf_tracking_memory_provider_t *p =
+        (umf_tracking_memory_provider_t *)provider;
+    ipc_opened_value_t *evicted = NULL;
+    umf_result_t ret = UMF_RESULT_SUCCESS;
+
+    utils_mutex_lock(&p->ipcOpenedLock);
+
+    ipc_opened_value_t *value = critnib_get(p->ipcOpenedPtrs, (uintptr_t)ptr);
+    if (!value) {
+        utils_mutex_unlock(&p->ipcOpenedLock);
+        return closeIpcHandleUpstream(p, ptr, size);
+    }
+
+    if (value->refcount == 0) {
+        // the mapping is only cached, so the handle was already closed
+        utils_mutex_unlock(&p->ipcOpenedLock);
+        LOG_ERR("IPC handle of pointer %p is already closed", ptr);
+        return UMF_RESULT_ERROR_INVALID_ARGUMENT;
+    }
+
+    if (--value->refcount == 0) {
+        ipcUnusedLink(p, value);
+        evicted = ipcOpenedEvict(p);
+    }
+
+    utils_mutex_unlock(&p->ipcOpenedLock);
+
+    while (evicted) {
+        ipc_opened_value_t *next = evicted->next;
+        umf_result_t ret_close =
+            closeIpcHandleUpstream(p, evicted->ptr, evicted->key.baseSize);
+        if (ret_close != UMF_RESULT_SUCCESS) {
+            ret = ret_close;
+        }
+        umf_ba_global_free(evicted);
+        evicted = next;
+    }
+
+    return ret;
+}
+
+// close unused mappings and free all entries of the opened IPC handles cache
+static void ipcOpenedCacheDestroy(umf_tracking_memory_provider_t *p) {
+    // entries are looked up by their pointers, because an entry which failed
+    // to be re-keyed is not in ipcOpened
+    uintptr_t rkey;
+    void *rvalue;
+    while (1 == critnib_find(p->ipcOpenedPtrs, 0, FIND_GE, &rkey, &rvalue)) {
+        ipc_opened_value_t *value = rvalue;
+        ipcOpenedRemove(p, value);
+
+        // mappings still in use are left to clearing the tracker
+        if (value->refcount == 0) {
+            (void)closeIpcHandleUpstream(p, value->ptr, value->key.baseSize);
+        }
+        umf_ba_global_free(value);
+    }
+
+    ravl_delete(p->ipcOpened);
+    critnib_delete(p->ipcOpenedPtrs);
+    utils_mutex_destroy_not_free(&p->ipcOpenedLock);
+}
+
 umf_memory_provider_ops_t UMF_TRACKING_MEMORY_PROVIDER_OPS = {
     .version = UMF_VERSION_CURRENT,
     .initialize = trackingInitialize,
@@ -694,11 +1816,13 @@ umf_memory_provider_ops_t UMF_TRACKING_MEMORY_PROVIDER_OPS = {
 
 umf_result_t umfTrackingMemoryProviderCreate(
     umf_memory_provider_handle_t hUpstream, umf_memory_pool_handle_t hPool,
-    umf_memory_provider_handle_t *hTrackingProvider, bool upstreamDoesNotFree) {
+    umf_memory_provider_handle_t *hTrackingProvider, bool upstreamDoesNotFree,
+    bool coarse) {
 
     umf_tracking_memory_provider_t params;
     params.hUpstream = hUpstream;
     params.upstreamDoesNotFree = upstreamDoesNotFree;
+    params.coarse = coarse;
     params.hTracker = TRACKER;
     if (!params.hTracker) {
         LOG_ERR("failed, TRACKER is NULL");
@@ -749,17 +1873,26 @@ umf_memory_tracker_handle_t umfMemoryTrackerCreate(void) {
         goto err_destroy_tracker_allocator;
     }
 
-    handle->map = critnib_new();
-    if (!handle->map) {
-        goto err_destroy_mutex;
+    size_t n_maps = 0;
+    for (; n_maps <= TRACKER_NUM_SHARDS; n_maps++) {
+        handle->maps[n_maps] = critnib_new();
+        if (!handle->maps[n_maps]) {
+            goto err_delete_maps;
+        }
     }
 
-    LOG_DEBUG("tracker created, handle=%p, segment map=%p", (void *)handle,
-              (void *)handle->map);
+    // entries cached for a previous tracker are not valid anymore
+    tracker_cache_invalidate_all();
+
+    LOG_DEBUG("tracker created, handle=%p, segment maps=%zu", (void *)handle,
+              n_maps);
 
     return handle;
 
-err_destroy_mutex:
+err_delete_maps:
+    while (n_maps--) {
+        critnib_delete(handle->maps[n_maps]);
+    }
     utils_mutex_destroy_not_free(&handle->splitMergeMutex);
 err_destroy_tracker_allocator:
     umf_ba_destroy(tracker_allocator);
@@ -785,10 +1918,137 @@ void umfMemoryTrackerDestroy(umf_memory_tracker_handle_t handle) {
     // We have to zero all inner pointers,
     // because the tracker handle can be copied
     // and used in many places.
-    critnib_delete(handle->map);
-    handle->map = NULL;
+    for (size_t m = 0; m <= TRACKER_NUM_SHARDS; m++) {
+        critnib_delete(handle->maps[m]);
+        handle->maps[m] = NULL;
+    }
     utils_mutex_destroy_not_free(&handle->splitMergeMutex);
     umf_ba_destroy(handle->tracker_allocator);
     handle->tracker_allocator = NULL;
     umf_ba_global_free(handle);
 }
+
+umf_result_t umfTrackingMemoryProviderSetIPCCacheCapacity(
+    umf_memory_provider_handle_t hTrackingProvider, umf_ipc_cache_t cache,
+    size_t capacity) {
+    umf_tracking_memory_provider_t *p =
+        (umf_tracking_memory_provider_t *)hTrackingProvider;
+
+    switch (cache) {
+    case UMF_IPC_CACHE_EXPORTED: {
+        // the handle returned by the call that added it has to be kept
+        if (capacity == 0) {
+            LOG_ERR("capacity of the cache of exported IPC handles is 0");
+            return UMF_RESULT_ERROR_INVALID_ARGUMENT;
+        }
+
+        utils_mutex_lock(&p->ipcCacheLock);
+        p->ipcCacheCapacity = capacity;
+        ipc_cache_value_t *evicted = ipcCacheEvict(p);
+        utils_mutex_unlock(&p->ipcCacheLock);
+
+        ipcCachePutEvicted(p, evicted);
+        return UMF_RESULT_SUCCESS;
+    }
+    case UMF_IPC_CACHE_OPENED: {
+        utils_mutex_lock(&p->ipcOpenedLock);
+        p->ipcOpenedMaxUnused = capacity;
+        ipc_opened_value_t *evicted = ipcOpenedEvict(p);
+        utils_mutex_unlock(&p->ipcOpenedLock);
+
+        while (evicted) {
+            ipc_opened_value_t *next = evicted->next;
+            (void)closeIpcHandleUpstream(p, evicted->ptr,
+                                         evicted->key.baseSize);
+            umf_ba_global_free(evicted);
+            evicted = next;
+        }
+        return UMF_RESULT_SUCCESS;
+    }
+    default:
+        LOG_ERR("unknown IPC cache: %d", (int)cache);
+        return UMF_RESULT_ERROR_INVALID_ARGUMENT;
+    }
+}
+
+umf_result_t umfTrackingMemoryProviderGetIPCCacheStats(
+    umf_memory_provider_handle_t hTrackingProvider, umf_ipc_cache_t cache,
+    umf_ipc_cache_stats_t *stats) {
+    umf_tracking_memory_provider_t *p =
+        (umf_tracking_memory_provider_t *)hTrackingProvider;
+
+    switch (cache) {
+    case UMF_IPC_CACHE_EXPORTED:
+        utils_mutex_lock(&p->ipcCacheLock);
+        *stats = p->ipcCacheStats;
+        stats->size = p->ipcCacheCount;
+        utils_mutex_unlock(&p->ipcCacheLock);
+        return UMF_RESULT_SUCCESS;
+    case UMF_IPC_CACHE_OPENED:
+        utils_mutex_lock(&p->ipcOpenedLock);
+        *stats = p->ipcOpenedStats;
+        utils_mutex_unlock(&p->ipcOpenedLock);
+        return UMF_RESULT_SUCCESS;
+    default:
+        LOG_ERR("unknown IPC cache: %d", (int)cache);
+        return UMF_RESULT_ERROR_INVALID_ARGUMENT;
+    }
+}
+
+// same base allocation of the same process
+static bool isSameIpcBase(const umf_ipc_data_t *lhs, const umf_ipc_data_t *rhs,
+                          size_t ipcDataSize) {
+    return lhs->pid == rhs->pid && lhs->generation == rhs->generation &&
+           lhs->baseSize == rhs->baseSize &&
+           memcmp(lhs->providerIpcData, rhs->providerIpcData, ipcDataSize) ==
+               0;
+}
+
+umf_result_t umfTrackingMemoryProviderOpenIPCHandles(
+    umf_memory_provider_handle_t hTrackingProvider,
+    const umf_ipc_handle_t *ipcHandles, size_t count, void **bases) {
+    umf_tracking_memory_provider_t *p =
+        (umf_tracking_memory_provider_t *)hTrackingProvider;
+    umf_result_t ret = UMF_RESULT_SUCCESS;
+
+    size_t ipcDataSize = 0;
+    ret = umfMemoryProviderGetIPCHandleSize(p->hUpstream, &ipcDataSize);
+    if (ret != UMF_RESULT_SUCCESS) {
+        LOG_ERR("upstream provider failed to get the size of IPC handle");
+        return ret;
+    }
+
+    size_t i;
+    ipc_opened_value_t *value = NULL;
+    for (i = 0; i < count; i++) {
+        // handles of the same base allocation usually come one after another,
+        // they share the cache entry (kept alive by the reference taken for
+        // the previous handle) without looking it up again
+        if (value && isSameIpcBase(ipcHandles[i - 1], ipcHandles[i],
+                                   ipcDataSize)) {
+            utils_mutex_lock(&p->ipcOpenedLock);
+            value->refcount++;
+            p->ipcOpenedStats.hits++;
+            utils_mutex_unlock(&p->ipcOpenedLock);
+            bases[i] = value->ptr;
+            continue;
+        }
+
+        ret = ipcOpenedGet(p, ipcHandles[i]->providerIpcData, ipcDataSize,
+                           &bases[i], &value);
+        if (ret != UMF_RESULT_SUCCESS) {
+            LOG_ERR("failed to open IPC handle %zu of %zu", i, count);
+            break;
+        }
+    }
+
+    if (ret != UMF_RESULT_SUCCESS) {
+        // close the handles opened so far
+        for (size_t j = 0; j < i; j++) {
+            (void)trackingCloseIpcHandle(p, bases[j], ipcHandles[j]->baseSize);
+            bases[j] = NULL;
+        }
+    }
+
+    return ret;
+}
@@ -15,6 +15,7 @@
 #include <stdlib.h>
 
 #include <umf/base.h>
+#include <umf/ipc.h>
 #include <umf/memory_pool.h>
 #include <umf/memory_provider.h>
 
@@ -26,9 +27,17 @@
 extern "C" {
 #endif
 
+// The address space is divided into granules of (1 << TRACKER_SHARD_SHIFT)
+// bytes, assigned round-robin to TRACKER_NUM_SHARDS shards, each with its own
+// critnib (and its own write lock). A region contained in a single granule is
+// kept in the shard of that granule, a region crossing a granule boundary is
+// kept in the last map (maps[TRACKER_NUM_SHARDS]).
+#define TRACKER_SHARD_SHIFT 21
+#define TRACKER_NUM_SHARDS 16
+
 struct umf_memory_tracker_t {
     umf_ba_pool_t *tracker_allocator;
-    critnib *map;
+    critnib *maps[TRACKER_NUM_SHARDS + 1];
     utils_mutex_t splitMergeMutex;
 };
 
@@ -45,6 +54,11 @@ typedef struct umf_alloc_info_t {
     void *base;
     size_t baseSize;
     umf_memory_pool_handle_t pool;
+
+    // base and baseSize describe an extent of a pool with coarse tracking,
+    // which may hold many allocations of the memory provider, and not
+    // a single allocation
+    bool coarse;
 } umf_alloc_info_t;
 
 umf_result_t umfMemoryTrackerGetAllocInfo(const void *ptr,
@@ -52,14 +66,32 @@ umf_result_t umfMemoryTrackerGetAllocInfo(const void *ptr,
 
 // Creates a memory provider that tracks each allocation/deallocation through umf_memory_tracker_handle_t and
 // forwards all requests to hUpstream memory Provider. hUpstream lifetime should be managed by the user of this function.
+// With coarse set, small allocations are carved from larger extents allocated
+// from hUpstream and only the extents are added to the tracker.
 umf_result_t umfTrackingMemoryProviderCreate(
     umf_memory_provider_handle_t hUpstream, umf_memory_pool_handle_t hPool,
-    umf_memory_provider_handle_t *hTrackingProvider, bool upstreamDoesNotFree);
+    umf_memory_provider_handle_t *hTrackingProvider, bool upstreamDoesNotFree,
+    bool coarse);
 
 void umfTrackingMemoryProviderGetUpstreamProvider(
     umf_memory_provider_handle_t hTrackingProvider,
     umf_memory_provider_handle_t *hUpstream);
 
+umf_result_t umfTrackingMemoryProviderSetIPCCacheCapacity(
+    umf_memory_provider_handle_t hTrackingProvider, umf_ipc_cache_t cache,
+    size_t capacity);
+
+umf_result_t umfTrackingMemoryProviderGetIPCCacheStats(
+    umf_memory_provider_handle_t hTrackingProvider, umf_ipc_cache_t cache,
+    umf_ipc_cache_stats_t *stats);
+
+// Opens the IPC handles (or takes references to their cached mappings) under
+// a single lock and returns the base addresses of their mappings.
+// On failure, no handle is left open.
+umf_result_t umfTrackingMemoryProviderOpenIPCHandles(
+    umf_memory_provider_handle_t hTrackingProvider,
+    const umf_ipc_handle_t *ipcHandles, size_t count, void **bases);
+
 #ifdef __cplusplus
 }
 #endif
@@ -94,6 +94,10 @@ int utils_getpid(void);
 // get the current thread ID
 int utils_gettid(void);
 
+// get the CPU and the NUMA node the calling thread is running on,
+// returns 0 on success
+int utils_getcpu(unsigned *cpu, unsigned *node);
+
 // close file descriptor
 int utils_close_fd(int fd);
 
@@ -126,6 +130,9 @@ size_t get_max_file_size(void);
 
 int utils_get_file_size(int fd, size_t *size);
 
+// get the device and inode numbers, which identify the file open as fd
+int utils_get_file_id(int fd, uint64_t *dev, uint64_t *ino);
+
 int utils_set_file_size(int fd, size_t size);
 
 void *utils_mmap(void *hint_addr, size_t length, int prot, int flag, int fd,
@@ -7,8 +7,15 @@
  *
  */
 
+#define _GNU_SOURCE 1
+
+#include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/syscall.h>
@@ -19,8 +26,99 @@
 #include <umf/memory_provider.h>
 
 #include "utils_common.h"
+#include "utils_concurrency.h"
 #include "utils_log.h"
 
+// __GLIBC_PREREQ() is defined only by glibc, so it cannot be used
+// in the same condition as defined(__GLIBC__)
+#if defined(__GLIBC__)
+#if __GLIBC_PREREQ(2, 29)
+#define UTILS_HAVE_GETCPU 1
+#endif
+#endif
+
+#ifndef UTILS_HAVE_GETCPU
+// Without getcpu(), the CPU is taken from sched_getcpu() (which uses vDSO
+// in glibc and musl where available) and its NUMA node from a table read
+// from sysfs once, so that no system call is made on every call.
+#define UTILS_CPU_NODE_MAX_CPUS 4096
+#define UTILS_SYSFS_NODE_DIR "/sys/devices/system/node"
+
+static uint16_t Cpu_node[UTILS_CPU_NODE_MAX_CPUS];
+static UTIL_ONCE_FLAG Cpu_node_initialized = UTIL_ONCE_FLAG_INIT;
+
+// set the node of the CPUs of a cpulist, e.g. "0-3,8-11"
+static void cpu_node_set_cpulist(const char *cpulist, unsigned node) {
+    const char *p = cpulist;
+    while (*p >= '0' && *p <= '9') {
+        char *end;
+        unsigned long first = strtoul(p, &end, 10);
+        unsigned long last = first;
+        if (*end == '-') {
+            last = strtoul(end + 1, &end, 10);
+        }
+
+        for (unsigned long cpu = first;
+             cpu <= last && cpu < UTILS_CPU_NODE_MAX_CPUS; cpu++) {
+            Cpu_node[cpu] = (uint16_t)node;
+        }
+
+        p = (*end == ',') ? end + 1 : end;
+    }
+}
+
+static void cpu_node_init(void) {
+    DIR *dir = opendir(UTILS_SYSFS_NODE_DIR);
+    if (!dir) {
+        // all CPUs are reported on node 0
+        LOG_DEBUG("cannot open %s, errno = %d", UTILS_SYSFS_NODE_DIR, errno);
+        return;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        unsigned node;
+        if (sscanf(entry->d_name, "node%u", &node) != 1) {
+            continue;
+        }
+
+        char path[256];
+        snprintf(path, sizeof(path), UTILS_SYSFS_NODE_DIR "/node%u/cpulist",
+                 node);
+        FILE *file = fopen(path, "r");
+        if (!file) {
+            continue;
+        }
+
+        char cpulist[4096];
+        if (fgets(cpulist, sizeof(cpulist), file)) {
+            cpu_node_set_cpulist(cpulist, node);
+        }
+        fclose(file);
+    }
+
+    closedir(dir);
+}
+#endif /* UTILS_HAVE_GETCPU */
+
+int utils_getcpu(unsigned *cpu, unsigned *node) {
+#ifdef UTILS_HAVE_GETCPU
+    // getcpu() of glibc uses vDSO, so it does not enter the kernel
+    return getcpu(cpu, node);
+#else
+    int ret = sched_getcpu();
+    if (ret < 0) {
+        return -1;
+    }
+
+    utils_init_once(&Cpu_node_initialized, cpu_node_init);
+
+    *cpu = (unsigned)ret;
+    *node = *cpu < UTILS_CPU_NODE_MAX_CPUS ? Cpu_node[*cpu] : 0;
+    return 0;
+#endif
+}
+
 umf_result_t
 utils_translate_mem_visibility_flag(umf_memory_visibility_t in_flag,
                                     unsigned *out_flag) {
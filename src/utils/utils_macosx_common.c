@@ -14,6 +14,12 @@
 
 #include "utils_log.h"
 
+int utils_getcpu(unsigned *cpu, unsigned *node) {
+    (void)cpu;  // unused
+    (void)node; // unused
+    return -1;  // not supported
+}
+
 umf_result_t
 utils_translate_mem_visibility_flag(umf_memory_visibility_t in_flag,
                                     unsigned *out_flag) {
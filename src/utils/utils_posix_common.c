@@ -138,6 +138,19 @@ umf_result_t utils_translate_mem_protection_one_flag(unsigned in_protection,
 
 size_t get_max_file_size(void) { return OFF_T_MAX; }
 
+int utils_get_file_id(int fd, uint64_t *dev, uint64_t *ino) {
+    struct stat statbuf;
+    int ret = fstat(fd, &statbuf);
+    if (ret) {
+        LOG_PERR("fstat(%i) failed", fd);
+        return ret;
+    }
+
+    *dev = (uint64_t)statbuf.st_dev;
+    *ino = (uint64_t)statbuf.st_ino;
+    return 0;
+}
+
 umf_result_t utils_translate_mem_protection_flags(unsigned in_protection,
                                                   unsigned *out_protection) {
     // translate protection - combination of 'umf_mem_protection_flags_t' flags
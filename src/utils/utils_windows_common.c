@@ -40,6 +40,20 @@ int utils_getpid(void) { return GetCurrentProcessId(); }
 
 int utils_gettid(void) { return GetCurrentThreadId(); }
 
+int utils_getcpu(unsigned *cpu, unsigned *node) {
+    PROCESSOR_NUMBER proc_number;
+    USHORT node_number;
+
+    GetCurrentProcessorNumberEx(&proc_number);
+    if (!GetNumaProcessorNodeEx(&proc_number, &node_number)) {
+        return -1;
+    }
+
+    *cpu = proc_number.Group * 64 + proc_number.Number;
+    *node = node_number;
+    return 0;
+}
+
 int utils_close_fd(int fd) {
     (void)fd; // unused
     return -1;
@@ -133,6 +147,13 @@ int utils_get_file_size(int fd, size_t *size) {
     return -1;  // not supported on Windows
 }
 
+int utils_get_file_id(int fd, uint64_t *dev, uint64_t *ino) {
+    (void)fd;  // unused
+    (void)dev; // unused
+    (void)ino; // unused
+    return -1; // not supported on Windows
+}
+
 int utils_set_file_size(int fd, size_t size) {
     (void)fd;   // unused
     (void)size; // unused
@@ -117,3 +117,84 @@ INSTANTIATE_TEST_SUITE_P(umfIpcTestSuite, umfIpcTest,
                          ::testing::Values(ipcTestParams{
                              umfProxyPoolOps(), nullptr, &IPC_MOCK_PROVIDER_OPS,
                              nullptr, &hostMemoryAccessor, false}));
+
+using umf_test::test;
+
+TEST_F(test, IPCCacheCapacityAndStats) {
+    constexpr size_t SIZE = 100;
+    constexpr size_t NUM_ALLOCS = 3;
+
+    umf_memory_provider_handle_t hProvider = nullptr;
+    auto ret =
+        umfMemoryProviderCreate(&IPC_MOCK_PROVIDER_OPS, nullptr, &hProvider);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+
+    umf_memory_pool_handle_t hPool = nullptr;
+    ret = umfPoolCreate(umfProxyPoolOps(), hProvider, nullptr,
+                        UMF_POOL_CREATE_FLAG_OWN_PROVIDER, &hPool);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    umf::pool_unique_handle_t pool(hPool, &umfPoolDestroy);
+
+    ret = umfPoolSetIPCCacheCapacity(pool.get(), UMF_IPC_CACHE_EXPORTED, 0);
+    ASSERT_EQ(ret, UMF_RESULT_ERROR_INVALID_ARGUMENT);
+    ret = umfPoolSetIPCCacheCapacity(pool.get(), UMF_IPC_CACHE_EXPORTED, 2);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+
+    // every allocation of the proxy pool is a separate base allocation
+    void *ptrs[NUM_ALLOCS];
+    umf_ipc_handle_t ipcHandles[NUM_ALLOCS];
+    size_t handleSize = 0;
+    for (size_t i = 0; i < NUM_ALLOCS; ++i) {
+        ptrs[i] = umfPoolMalloc(pool.get(), SIZE);
+        ASSERT_NE(ptrs[i], nullptr);
+        ret = umfGetIPCHandle(ptrs[i], &ipcHandles[i], &handleSize);
+        ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    }
+
+    umf_ipc_handle_t ipcHandle = nullptr;
+    ret = umfGetIPCHandle(ptrs[NUM_ALLOCS - 1], &ipcHandle, &handleSize);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    ret = umfPutIPCHandle(ipcHandle);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+
+    umf_ipc_cache_stats_t stats;
+    ret = umfPoolGetIPCCacheStats(pool.get(), UMF_IPC_CACHE_EXPORTED, &stats);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    EXPECT_EQ(stats.hits, 1);
+    EXPECT_EQ(stats.misses, NUM_ALLOCS);
+    EXPECT_EQ(stats.evictions, 1);
+    EXPECT_EQ(stats.size, 2);
+
+    // opening the same handle twice maps it once
+    void *opened[2];
+    for (auto &ptr : opened) {
+        ret = umfOpenIPCHandle(pool.get(), ipcHandles[0], &ptr);
+        ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    }
+    EXPECT_EQ(opened[0], opened[1]);
+
+    ret = umfPoolSetIPCCacheCapacity(pool.get(), UMF_IPC_CACHE_OPENED, 0);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    for (auto ptr : opened) {
+        ret = umfCloseIPCHandle(ptr);
+        ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    }
+
+    ret = umfPoolGetIPCCacheStats(pool.get(), UMF_IPC_CACHE_OPENED, &stats);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    EXPECT_EQ(stats.hits, 1);
+    EXPECT_EQ(stats.misses, 1);
+    EXPECT_EQ(stats.evictions, 1);
+    EXPECT_EQ(stats.size, 0);
+
+    for (size_t i = 0; i < NUM_ALLOCS; ++i) {
+        ret = umfPutIPCHandle(ipcHandles[i]);
+        EXPECT_EQ(ret, UMF_RESULT_SUCCESS);
+        ret = umfPoolFree(pool.get(), ptrs[i]);
+        EXPECT_EQ(ret, UMF_RESULT_SUCCESS);
+    }
+
+    ret = umfPoolGetIPCCacheStats(pool.get(), UMF_IPC_CACHE_EXPORTED, &stats);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    EXPECT_EQ(stats.size, 0);
+}
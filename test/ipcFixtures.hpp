@@ -187,6 +187,46 @@ TEST_P(umfIpcTest, CloseIPCHandleInvalidPtr) {
     EXPECT_EQ(ret, UMF_RESULT_ERROR_INVALID_ARGUMENT);
 }
 
+TEST_P(umfIpcTest, CloseIPCHandleTwice) {
+    constexpr size_t SIZE = 100;
+    umf::pool_unique_handle_t pool = makePool();
+    void *ptr = umfPoolMalloc(pool.get(), SIZE);
+    ASSERT_NE(ptr, nullptr);
+
+    umf_ipc_handle_t ipcHandle = nullptr;
+    size_t handleSize = 0;
+    umf_result_t ret = umfGetIPCHandle(ptr, &ipcHandle, &handleSize);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+
+    void *openedPtr = nullptr;
+    ret = umfOpenIPCHandle(pool.get(), ipcHandle, &openedPtr);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+
+    ret = umfCloseIPCHandle(openedPtr);
+    EXPECT_EQ(ret, UMF_RESULT_SUCCESS);
+
+    // the mapping stays cached, but the handle is not opened anymore
+    ret = umfCloseIPCHandle(openedPtr);
+    EXPECT_EQ(ret, UMF_RESULT_ERROR_INVALID_ARGUMENT);
+
+    // the cached mapping is still usable after the failed close
+    ret = umfOpenIPCHandle(pool.get(), ipcHandle, &openedPtr);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    ret = umfCloseIPCHandle(openedPtr);
+    EXPECT_EQ(ret, UMF_RESULT_SUCCESS);
+
+    ret = umfPutIPCHandle(ipcHandle);
+    EXPECT_EQ(ret, UMF_RESULT_SUCCESS);
+
+    ret = umfPoolFree(pool.get(), ptr);
+    EXPECT_EQ(ret,
+              get_umf_result_of_free(freeNotSupported, UMF_RESULT_SUCCESS));
+
+    pool.reset(nullptr);
+    EXPECT_EQ(stat.openCount, 1);
+    EXPECT_EQ(stat.closeCount, stat.openCount);
+}
+
 TEST_P(umfIpcTest, BasicFlow) {
     constexpr size_t SIZE = 100;
     std::vector<int> expected_data(SIZE);
@@ -245,8 +285,126 @@ TEST_P(umfIpcTest, BasicFlow) {
     pool.reset(nullptr);
     EXPECT_EQ(stat.getCount, 1);
     EXPECT_EQ(stat.putCount, stat.getCount);
-    // TODO: enale check below once cache for open IPC handles is implemented
-    // EXPECT_EQ(stat.openCount, 1);
+    EXPECT_EQ(stat.openCount, 1);
+    EXPECT_EQ(stat.closeCount, stat.openCount);
+}
+
+TEST_P(umfIpcTest, BatchGetOpenHandles) {
+    constexpr size_t SIZE = 100;
+    constexpr size_t NUM_ALLOCS = 10;
+    std::vector<int> expected_data(SIZE);
+    std::iota(expected_data.begin(), expected_data.end(), 0);
+    umf::pool_unique_handle_t pool = makePool();
+
+    // every allocation is passed twice: by its start and by its middle
+    int *ptrs[NUM_ALLOCS];
+    const void *handlePtrs[2 * NUM_ALLOCS];
+    for (size_t i = 0; i < NUM_ALLOCS; ++i) {
+        ptrs[i] = (int *)umfPoolMalloc(pool.get(), SIZE * sizeof(int));
+        ASSERT_NE(ptrs[i], nullptr);
+        memAccessor->copy(ptrs[i], expected_data.data(), SIZE * sizeof(int));
+        handlePtrs[2 * i] = ptrs[i];
+        handlePtrs[2 * i + 1] = ptrs[i] + SIZE / 2;
+    }
+
+    umf_ipc_handle_t ipcHandles[2 * NUM_ALLOCS];
+    size_t handleSizes[2 * NUM_ALLOCS];
+    umf_result_t ret = umfGetIPCHandles(handlePtrs, 2 * NUM_ALLOCS,
+                                        ipcHandles, handleSizes);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+
+    void *openedPtrs[2 * NUM_ALLOCS];
+    ret = umfOpenIPCHandles(pool.get(), ipcHandles, 2 * NUM_ALLOCS,
+                            openedPtrs);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+
+    std::vector<int> actual_data(SIZE);
+    for (size_t i = 0; i < NUM_ALLOCS; ++i) {
+        EXPECT_EQ((int *)openedPtrs[2 * i + 1],
+                  (int *)openedPtrs[2 * i] + SIZE / 2);
+        memAccessor->copy(actual_data.data(), openedPtrs[2 * i],
+                          SIZE * sizeof(int));
+        ASSERT_TRUE(std::equal(expected_data.begin(), expected_data.end(),
+                               actual_data.begin()));
+    }
+
+    for (size_t i = 0; i < 2 * NUM_ALLOCS; ++i) {
+        ret = umfCloseIPCHandle(openedPtrs[i]);
+        EXPECT_EQ(ret, UMF_RESULT_SUCCESS);
+        ret = umfPutIPCHandle(ipcHandles[i]);
+        EXPECT_EQ(ret, UMF_RESULT_SUCCESS);
+    }
+
+    for (size_t i = 0; i < NUM_ALLOCS; ++i) {
+        ret = umfPoolFree(pool.get(), ptrs[i]);
+        EXPECT_EQ(ret,
+                  get_umf_result_of_free(freeNotSupported, UMF_RESULT_SUCCESS));
+    }
+
+    pool.reset(nullptr);
+    EXPECT_EQ(stat.getCount, stat.allocCount);
+    EXPECT_EQ(stat.putCount, stat.getCount);
+    EXPECT_EQ(stat.openCount, stat.allocCount);
+    EXPECT_EQ(stat.closeCount, stat.openCount);
+}
+
+TEST_P(umfIpcTest, GetIPCHandleToBuffer) {
+    constexpr size_t SIZE = 100;
+    std::vector<int> expected_data(SIZE);
+    std::iota(expected_data.begin(), expected_data.end(), 0);
+    umf::pool_unique_handle_t pool = makePool();
+
+    int *ptr = (int *)umfPoolMalloc(pool.get(), SIZE * sizeof(int));
+    ASSERT_NE(ptr, nullptr);
+    memAccessor->copy(ptr, expected_data.data(), SIZE * sizeof(int));
+
+    size_t handleSize = 0;
+    umf_result_t ret = umfPoolGetIPCHandleSize(pool.get(), &handleSize);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+
+    // the handle is written to a buffer owned by the caller
+    std::vector<uint64_t> buffer(handleSize / sizeof(uint64_t) + 1);
+    ret = umfGetIPCHandleToBuffer(ptr + SIZE / 2, buffer.data(),
+                                  handleSize - 1);
+    EXPECT_EQ(ret, UMF_RESULT_ERROR_INVALID_ARGUMENT);
+    ret = umfGetIPCHandleToBuffer(ptr + SIZE / 2, (char *)buffer.data() + 1,
+                                  handleSize);
+    EXPECT_EQ(ret, UMF_RESULT_ERROR_INVALID_ARGUMENT);
+    ret = umfGetIPCHandleToBuffer(ptr + SIZE / 2, buffer.data(), handleSize);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+
+    // a copy of the handle (e.g. received from another process) is opened
+    std::vector<uint64_t> received(buffer);
+    umf_ipc_handle_t ipcHandle =
+        reinterpret_cast<umf_ipc_handle_t>(received.data());
+    void *openedPtr = nullptr;
+    ret = umfOpenIPCHandle(pool.get(), ipcHandle, &openedPtr);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+
+    std::vector<int> actual_data(SIZE / 2);
+    memAccessor->copy(actual_data.data(), openedPtr,
+                      SIZE / 2 * sizeof(int));
+    ASSERT_TRUE(std::equal(expected_data.begin() + SIZE / 2,
+                           expected_data.end(), actual_data.begin()));
+
+    ret = umfCloseIPCHandle(openedPtr);
+    EXPECT_EQ(ret, UMF_RESULT_SUCCESS);
+
+    // a corrupted handle is rejected
+    reinterpret_cast<unsigned char *>(received.data())[0] ^= 0xff;
+    ret = umfOpenIPCHandle(pool.get(), ipcHandle, &openedPtr);
+    EXPECT_EQ(ret, UMF_RESULT_ERROR_INVALID_ARGUMENT);
+    ret = umfOpenIPCHandles(pool.get(), &ipcHandle, 1, &openedPtr);
+    EXPECT_EQ(ret, UMF_RESULT_ERROR_INVALID_ARGUMENT);
+
+    ret = umfPoolFree(pool.get(), ptr);
+    EXPECT_EQ(ret,
+              get_umf_result_of_free(freeNotSupported, UMF_RESULT_SUCCESS));
+
+    pool.reset(nullptr);
+    EXPECT_EQ(stat.getCount, 1);
+    EXPECT_EQ(stat.putCount, stat.getCount);
+    EXPECT_EQ(stat.openCount, 1);
     EXPECT_EQ(stat.closeCount, stat.openCount);
 }
 
@@ -531,8 +689,7 @@ TEST_P(umfIpcTest, ConcurrentOpenCloseHandles) {
     pool.reset(nullptr);
     EXPECT_EQ(stat.getCount, stat.allocCount);
     EXPECT_EQ(stat.putCount, stat.getCount);
-    // TODO: enale check below once cache for open IPC handles is implemented
-    // EXPECT_EQ(stat.openCount, stat.allocCount);
+    EXPECT_EQ(stat.openCount, stat.allocCount);
     EXPECT_EQ(stat.openCount, stat.closeCount);
 }
 
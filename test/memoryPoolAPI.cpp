@@ -7,6 +7,7 @@
 #include "pool.hpp"
 #include "poolFixtures.hpp"
 #include "provider.hpp"
+#include "provider/provider_tracking.h"
 #include "provider_null.h"
 #include "provider_trace.h"
 #include "test_helpers.h"
@@ -178,6 +179,214 @@ TEST_F(test, BasicPoolByPtrTest) {
     ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
 }
 
+TEST_F(test, PoolByPtrAfterFreeTest) {
+    constexpr size_t SIZE = 4096 * 1024;
+
+    umf_memory_provider_handle_t provider;
+    umf_result_t ret =
+        umfMemoryProviderCreate(&BA_GLOBAL_PROVIDER_OPS, NULL, &provider);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    auto pool =
+        wrapPoolUnique(createPoolChecked(umfProxyPoolOps(), provider, nullptr,
+                                         UMF_POOL_CREATE_FLAG_OWN_PROVIDER));
+
+    char *ptr = (char *)umfPoolMalloc(pool.get(), SIZE);
+    ASSERT_NE(ptr, nullptr);
+
+    // repeated lookups may be served from the per-thread cache
+    for (int i = 0; i < 2; i++) {
+        EXPECT_EQ(umfPoolByPtr(ptr), pool.get());
+        EXPECT_EQ(umfPoolByPtr(ptr + SIZE - 1), pool.get());
+    }
+
+    ret = umfFree(ptr);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+
+    // the freed region must not be found anymore
+    EXPECT_EQ(umfPoolByPtr(ptr), nullptr);
+    EXPECT_EQ(umfPoolByPtr(ptr + SIZE - 1), nullptr);
+}
+
+TEST_F(test, PoolByPtrAfterOtherPoolDestroyTest) {
+    constexpr size_t SIZE = 4096 * 1024;
+
+    auto createPool = []() {
+        umf_memory_provider_handle_t provider;
+        umf_result_t ret =
+            umfMemoryProviderCreate(&BA_GLOBAL_PROVIDER_OPS, NULL, &provider);
+        EXPECT_EQ(ret, UMF_RESULT_SUCCESS);
+        return wrapPoolUnique(
+            createPoolChecked(umfProxyPoolOps(), provider, nullptr,
+                              UMF_POOL_CREATE_FLAG_OWN_PROVIDER));
+    };
+
+    auto pool = createPool();
+    auto otherPool = createPool();
+
+    char *ptr = (char *)umfPoolMalloc(pool.get(), SIZE);
+    ASSERT_NE(ptr, nullptr);
+    char *otherPtr = (char *)umfPoolMalloc(otherPool.get(), SIZE);
+    ASSERT_NE(otherPtr, nullptr);
+
+    // destroying a pool removes only its own regions from the tracker
+    umfPoolFree(otherPool.get(), otherPtr);
+    otherPool.reset();
+
+    EXPECT_EQ(umfPoolByPtr(ptr), pool.get());
+    EXPECT_EQ(umfPoolByPtr(ptr + SIZE - 1), pool.get());
+
+    umf_result_t ret = umfFree(ptr);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+}
+
+TEST_F(test, PoolCoarseTrackingTest) {
+    static constexpr size_t PAGE_SIZE = 4096;
+    static size_t providerAllocs;
+
+    struct provider : public umf_test::provider_ba_global {
+        umf_result_t alloc(size_t size, size_t align, void **ptr) noexcept {
+            providerAllocs++;
+            return provider_ba_global::alloc(size, align, ptr);
+        }
+        umf_result_t get_recommended_page_size(size_t,
+                                               size_t *pageSize) noexcept {
+            *pageSize = PAGE_SIZE;
+            return UMF_RESULT_SUCCESS;
+        }
+        umf_result_t get_min_page_size(void *, size_t *pageSize) noexcept {
+            *pageSize = PAGE_SIZE;
+            return UMF_RESULT_SUCCESS;
+        }
+    };
+    umf_memory_provider_ops_t provider_ops =
+        umf::providerMakeCOps<provider, void>();
+
+    umf_memory_provider_handle_t hProvider;
+    umf_result_t ret = umfMemoryProviderCreate(&provider_ops, NULL, &hProvider);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+
+    auto pool = wrapPoolUnique(createPoolChecked(
+        umfProxyPoolOps(), hProvider, nullptr,
+        UMF_POOL_CREATE_FLAG_OWN_PROVIDER |
+            UMF_POOL_CREATE_FLAG_COARSE_TRACKING));
+
+    // small allocations are carved from a single extent
+    providerAllocs = 0;
+    std::array<char *, 16> ptrs;
+    for (auto &ptr : ptrs) {
+        ptr = (char *)umfPoolMalloc(pool.get(), PAGE_SIZE);
+        ASSERT_NE(ptr, nullptr);
+        memset(ptr, 0, PAGE_SIZE);
+    }
+    EXPECT_EQ(providerAllocs, 1);
+
+    // large allocations are tracked one by one
+    constexpr size_t LARGE_SIZE = 4096 * 1024;
+    char *large = (char *)umfPoolMalloc(pool.get(), LARGE_SIZE);
+    ASSERT_NE(large, nullptr);
+    EXPECT_EQ(providerAllocs, 2);
+
+    for (auto ptr : ptrs) {
+        EXPECT_EQ(umfPoolByPtr(ptr), pool.get());
+        EXPECT_EQ(umfPoolByPtr(ptr + PAGE_SIZE - 1), pool.get());
+    }
+    EXPECT_EQ(umfPoolByPtr(large + LARGE_SIZE - 1), pool.get());
+
+    for (auto ptr : ptrs) {
+        ret = umfFree(ptr);
+        ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    }
+    ret = umfFree(large);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    EXPECT_EQ(umfPoolByPtr(large), nullptr);
+
+    // the empty current extent is reused
+    char *ptr = (char *)umfPoolMalloc(pool.get(), PAGE_SIZE);
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(ptr, ptrs[0]);
+    EXPECT_EQ(providerAllocs, 2);
+    ret = umfFree(ptr);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+}
+
+TEST_F(test, PoolSplitMergeAcrossTrackerMapsTest) {
+    static constexpr size_t GRANULE = (size_t)1 << TRACKER_SHARD_SHIFT;
+    static umf_result_t splitResult;
+    static umf_memory_provider_handle_t trackingProvider;
+
+    struct provider : public umf_test::provider_ba_global {
+        umf_result_t allocation_split(void *, size_t, size_t) noexcept {
+            return splitResult;
+        }
+        umf_result_t allocation_merge(void *, void *, size_t) noexcept {
+            return UMF_RESULT_SUCCESS;
+        }
+    };
+    umf_memory_provider_ops_t provider_ops =
+        umf::providerMakeCOps<provider, void>();
+
+    // the pool is given the tracking provider, which splits and merges
+    // the regions in the tracker
+    struct pool : public umf_test::pool_base_t {
+        umf_result_t initialize(umf_memory_provider_handle_t hProvider) {
+            trackingProvider = hProvider;
+            return UMF_RESULT_SUCCESS;
+        }
+    };
+    umf_memory_pool_ops_t pool_ops = umf::poolMakeCOps<pool, void>();
+
+    umf_memory_provider_handle_t hProvider;
+    umf_result_t ret = umfMemoryProviderCreate(&provider_ops, NULL, &hProvider);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    auto hPool = wrapPoolUnique(createPoolChecked(
+        &pool_ops, hProvider, nullptr, UMF_POOL_CREATE_FLAG_OWN_PROVIDER));
+
+    auto expectRegion = [&](char *base, size_t size) {
+        for (char *ptr : {base, base + size - 1}) {
+            EXPECT_EQ(umfPoolByPtr(ptr), hPool.get());
+            umf_alloc_info_t allocInfo = {NULL, 0, NULL, false};
+            ASSERT_EQ(umfMemoryTrackerGetAllocInfo(ptr, &allocInfo),
+                      UMF_RESULT_SUCCESS);
+            EXPECT_EQ(allocInfo.base, base);
+            EXPECT_EQ(allocInfo.baseSize, size);
+            EXPECT_EQ(allocInfo.pool, hPool.get());
+        }
+    };
+
+    // the region crosses a granule boundary (it is in the crossing map),
+    // each of its halves is contained in a single granule (in a shard)
+    char *ptr = nullptr;
+    ret = umfMemoryProviderAlloc(trackingProvider, 2 * GRANULE, GRANULE,
+                                 (void **)&ptr);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    ASSERT_NE(ptr, nullptr);
+    expectRegion(ptr, 2 * GRANULE);
+
+    // a failed upstream split leaves the tracker unchanged
+    splitResult = UMF_RESULT_ERROR_UNKNOWN;
+    ret = umfMemoryProviderAllocationSplit(trackingProvider, ptr, 2 * GRANULE,
+                                           GRANULE);
+    EXPECT_EQ(ret, UMF_RESULT_ERROR_UNKNOWN);
+    expectRegion(ptr, 2 * GRANULE);
+
+    splitResult = UMF_RESULT_SUCCESS;
+    ret = umfMemoryProviderAllocationSplit(trackingProvider, ptr, 2 * GRANULE,
+                                           GRANULE);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    expectRegion(ptr, GRANULE);
+    expectRegion(ptr + GRANULE, GRANULE);
+
+    ret = umfMemoryProviderAllocationMerge(trackingProvider, ptr,
+                                           ptr + GRANULE, 2 * GRANULE);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    expectRegion(ptr, 2 * GRANULE);
+
+    ret = umfMemoryProviderFree(trackingProvider, ptr, 2 * GRANULE);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    EXPECT_EQ(umfPoolByPtr(ptr), nullptr);
+    EXPECT_EQ(umfPoolByPtr(ptr + 2 * GRANULE - 1), nullptr);
+}
+
 INSTANTIATE_TEST_SUITE_P(
     mallocPoolTest, umfPoolTest,
     ::testing::Values(poolCreateExtParams{&MALLOC_POOL_OPS, nullptr,
@@ -9,6 +9,10 @@
 #include "provider_null.h"
 #include "provider_trace.h"
 
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
 umf_disjoint_pool_params_t poolConfig() {
     umf_disjoint_pool_params_t config{};
     config.SlabMinSize = 4096;
@@ -144,7 +148,849 @@ TEST_F(test, sharedLimits) {
     EXPECT_EQ(MaxSize / SlabMinSize * 2, numFrees);
 }
 
+TEST_F(test, threadCacheFlush) {
+    static std::atomic<size_t> numAllocs = 0;
+    static std::atomic<size_t> numFrees = 0;
+
+    struct memory_provider : public umf_test::provider_base_t {
+        umf_result_t alloc(size_t size, size_t, void **ptr) noexcept {
+            *ptr = malloc(size);
+            numAllocs++;
+            return UMF_RESULT_SUCCESS;
+        }
+        umf_result_t free(void *ptr, [[maybe_unused]] size_t size) noexcept {
+            ::free(ptr);
+            numFrees++;
+            return UMF_RESULT_SUCCESS;
+        }
+    };
+    umf_memory_provider_ops_t provider_ops =
+        umf::providerMakeCOps<memory_provider, void>();
+
+    auto provider =
+        wrapProviderUnique(createProviderChecked(&provider_ops, nullptr));
+
+    auto config = poolConfig();
+    config.ThreadCacheSize = 16;
+
+    umf_memory_pool_handle_t pool = NULL;
+    auto ret = umfPoolCreate(umfDisjointPoolOps(), provider.get(),
+                             (void *)&config, 0, &pool);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    auto poolHandle = umf_test::wrapPoolUnique(pool);
+
+    static constexpr size_t allocSize = 64;
+    static constexpr size_t numPtrs = 256;
+
+    // allocate in one thread and free in another one, so chunks are cached
+    // by both threads
+    std::vector<void *> ptrs(numPtrs);
+    std::thread allocator([&] {
+        for (auto &ptr : ptrs) {
+            ptr = umfPoolMalloc(pool, allocSize);
+            ASSERT_NE(ptr, nullptr);
+        }
+    });
+    allocator.join();
+
+    std::thread deallocator([&] {
+        for (auto &ptr : ptrs) {
+            ASSERT_EQ(umfPoolFree(pool, ptr), UMF_RESULT_SUCCESS);
+        }
+    });
+    deallocator.join();
+
+    // leave some chunks in the cache of the main thread
+    void *ptr = umfPoolMalloc(pool, allocSize);
+    ASSERT_NE(ptr, nullptr);
+    ASSERT_EQ(umfPoolFree(pool, ptr), UMF_RESULT_SUCCESS);
+
+    // both threads exited, so only the slab kept in the pool and slabs
+    // holding chunks cached by the main thread are still allocated
+    EXPECT_GT(numFrees, 0);
+
+    poolHandle.reset();
+    EXPECT_EQ(numAllocs, numFrees);
+}
+
+TEST_F(test, reallocAndUsableSize) {
+    umf_memory_pool_handle_t pool = NULL;
+    auto config = poolConfig();
+    auto provider = wrapProviderUnique(
+        createProviderChecked(&BA_GLOBAL_PROVIDER_OPS, nullptr));
+    auto ret = umfPoolCreate(umfDisjointPoolOps(), provider.get(),
+                             (void *)&config, 0, &pool);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    auto poolHandle = umf_test::wrapPoolUnique(pool);
+
+    // 100 bytes are served from the 128-byte bucket
+    auto *ptr = static_cast<char *>(umfPoolMalloc(pool, 100));
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(umfPoolMallocUsableSize(pool, ptr), 128);
+    memset(ptr, 0xAB, 100);
+
+    // the same bucket, so the allocation is reused
+    EXPECT_EQ(umfPoolRealloc(pool, ptr, 120), ptr);
+
+    // a larger bucket, the content must be preserved
+    auto *newPtr = static_cast<char *>(umfPoolRealloc(pool, ptr, 1000));
+    ASSERT_NE(newPtr, nullptr);
+    EXPECT_NE(newPtr, ptr);
+    EXPECT_GE(umfPoolMallocUsableSize(pool, newPtr), 1000);
+    for (size_t i = 0; i < 100; i++) {
+        ASSERT_EQ(newPtr[i], (char)0xAB);
+    }
+
+    // above MaxPoolableSize the allocation comes from the provider
+    newPtr = static_cast<char *>(
+        umfPoolRealloc(pool, newPtr, config.MaxPoolableSize * 4));
+    ASSERT_NE(newPtr, nullptr);
+    EXPECT_GE(umfPoolMallocUsableSize(pool, newPtr),
+              config.MaxPoolableSize * 4);
+    EXPECT_EQ(newPtr[0], (char)0xAB);
+
+    // realloc to 0 frees the memory
+    EXPECT_EQ(umfPoolRealloc(pool, newPtr, 0), nullptr);
+}
+
+TEST_F(test, reallocWithoutTracking) {
+    umf_memory_pool_handle_t pool = NULL;
+    auto config = poolConfig();
+    auto provider = wrapProviderUnique(
+        createProviderChecked(&BA_GLOBAL_PROVIDER_OPS, nullptr));
+    auto ret =
+        umfPoolCreate(umfDisjointPoolOps(), provider.get(), (void *)&config,
+                      UMF_POOL_CREATE_FLAG_DISABLE_TRACKING, &pool);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    auto poolHandle = umf_test::wrapPoolUnique(pool);
+
+    // the size of an allocation from the provider is known to the pool
+    size_t size = config.MaxPoolableSize * 2;
+    auto *ptr = static_cast<char *>(umfPoolMalloc(pool, size));
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(umfPoolMallocUsableSize(pool, ptr), size);
+    memset(ptr, 0xAB, size);
+
+    auto *newPtr = static_cast<char *>(umfPoolRealloc(pool, ptr, size * 2));
+    ASSERT_NE(newPtr, nullptr);
+    for (size_t i = 0; i < size; i++) {
+        ASSERT_EQ(newPtr[i], (char)0xAB);
+    }
+
+    // memory not allocated from the pool is rejected and left intact
+    char foreign[64];
+    memset(foreign, 0xCD, sizeof(foreign));
+    EXPECT_EQ(umfPoolRealloc(pool, foreign, 128), nullptr);
+    EXPECT_EQ(umfPoolGetLastAllocationError(pool),
+              UMF_RESULT_ERROR_INVALID_ARGUMENT);
+    EXPECT_EQ(foreign[0], (char)0xCD);
+
+    EXPECT_EQ(umfPoolFree(pool, newPtr), UMF_RESULT_SUCCESS);
+}
+
+// Provider of zeroed memory reporting its page sizes, so that the memory
+// can be tracked coarsely. It does not support purging.
+static size_t coarseProviderAllocs = 0;
+struct coarse_provider : public umf_test::provider_base_t {
+    static constexpr size_t PageSize = 4096;
+
+    umf_result_t alloc(size_t size, size_t align, void **ptr) noexcept {
+        if (align < PageSize) {
+            align = PageSize;
+        }
+        *ptr = aligned_alloc(align, ALIGN_UP(size, align));
+        if (!*ptr) {
+            return UMF_RESULT_ERROR_OUT_OF_HOST_MEMORY;
+        }
+        memset(*ptr, 0, size);
+        coarseProviderAllocs++;
+        return UMF_RESULT_SUCCESS;
+    }
+    umf_result_t free(void *ptr, [[maybe_unused]] size_t size) noexcept {
+        ::free(ptr);
+        return UMF_RESULT_SUCCESS;
+    }
+    umf_result_t get_recommended_page_size([[maybe_unused]] size_t size,
+                                           size_t *pageSize) noexcept {
+        *pageSize = PageSize;
+        return UMF_RESULT_SUCCESS;
+    }
+    umf_result_t get_min_page_size([[maybe_unused]] void *ptr,
+                                   size_t *pageSize) noexcept {
+        *pageSize = PageSize;
+        return UMF_RESULT_SUCCESS;
+    }
+};
+umf_memory_provider_ops_t COARSE_PROVIDER_OPS =
+    umf::providerMakeCOps<coarse_provider, void>();
+
+TEST_F(test, reallocCoarseTracking) {
+    umf_memory_pool_handle_t pool = NULL;
+    auto config = poolConfig();
+    config.LargeCacheSize = 1024 * 1024;
+    auto provider = wrapProviderUnique(
+        createProviderChecked(&COARSE_PROVIDER_OPS, nullptr));
+    auto ret =
+        umfPoolCreate(umfDisjointPoolOps(), provider.get(), (void *)&config,
+                      UMF_POOL_CREATE_FLAG_COARSE_TRACKING, &pool);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    auto poolHandle = umf_test::wrapPoolUnique(pool);
+
+    // both allocations are carved from a single extent
+    size_t numAllocs = coarseProviderAllocs;
+    void *ptrs[2];
+    for (auto &ptr : ptrs) {
+        ptr = umfPoolMalloc(pool, config.MaxPoolableSize * 2);
+        ASSERT_NE(ptr, nullptr);
+    }
+    EXPECT_EQ(coarseProviderAllocs, numAllocs + 1);
+    for (auto ptr : ptrs) {
+        EXPECT_EQ(umfPoolFree(pool, ptr), UMF_RESULT_SUCCESS);
+    }
+
+    // the tracker knows only the extents, the pool keeps the sizes itself
+    for (size_t size : {config.MaxPoolableSize * 2, (size_t)256 * 1024}) {
+        for (int i = 0; i < 2; i++) {
+            auto *ptr = static_cast<char *>(umfPoolMalloc(pool, size));
+            ASSERT_NE(ptr, nullptr);
+            EXPECT_GE(umfPoolMallocUsableSize(pool, ptr), size);
+            memset(ptr, 0xAB, size);
+
+            auto *newPtr =
+                static_cast<char *>(umfPoolRealloc(pool, ptr, size * 2));
+            ASSERT_NE(newPtr, nullptr);
+            for (size_t j = 0; j < size; j++) {
+                ASSERT_EQ(newPtr[j], (char)0xAB);
+            }
+
+            // the second round reuses the large allocation cache
+            EXPECT_EQ(umfPoolFree(pool, newPtr), UMF_RESULT_SUCCESS);
+        }
+    }
+}
+
+TEST_F(test, callocCoarseTracking) {
+    umf_memory_pool_handle_t pool = NULL;
+    auto config = poolConfig();
+    config.SlabMinSize = 64 * 1024;
+    config.MaxPoolableSize = 64 * 1024;
+    config.Capacity = 0; // free slabs are returned to the provider at once
+    config.ProviderMemoryZeroed = 1;
+    auto provider = wrapProviderUnique(
+        createProviderChecked(&COARSE_PROVIDER_OPS, nullptr));
+    auto ret =
+        umfPoolCreate(umfDisjointPoolOps(), provider.get(), (void *)&config,
+                      UMF_POOL_CREATE_FLAG_COARSE_TRACKING, &pool);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    auto poolHandle = umf_test::wrapPoolUnique(pool);
+
+    // the space of a freed allocation is reused within its extent
+    for (size_t size : {config.MaxPoolableSize, config.MaxPoolableSize * 2}) {
+        for (int i = 0; i < 2; i++) {
+            auto *ptr = static_cast<char *>(umfPoolCalloc(pool, 1, size));
+            ASSERT_NE(ptr, nullptr);
+            for (size_t j = 0; j < size; j++) {
+                ASSERT_EQ(ptr[j], 0);
+            }
+            memset(ptr, 0xAB, size);
+            ASSERT_EQ(umfPoolFree(pool, ptr), UMF_RESULT_SUCCESS);
+        }
+    }
+}
+
+TEST_F(test, callocReusedChunk) {
+    umf_memory_pool_handle_t pool = NULL;
+    auto config = poolConfig();
+    config.ProviderMemoryZeroed = 1;
+    auto provider = wrapProviderUnique(
+        createProviderChecked(&BA_GLOBAL_PROVIDER_OPS, nullptr));
+    auto ret = umfPoolCreate(umfDisjointPoolOps(), provider.get(),
+                             (void *)&config, 0, &pool);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    auto poolHandle = umf_test::wrapPoolUnique(pool);
+
+    for (size_t size : {(size_t)64, config.SlabMinSize}) {
+        auto *ptr = umfPoolMalloc(pool, size);
+        ASSERT_NE(ptr, nullptr);
+        memset(ptr, 0xFF, size);
+        ASSERT_EQ(umfPoolFree(pool, ptr), UMF_RESULT_SUCCESS);
+
+        // the memory is taken from the pool, so it has to be cleared
+        auto *zeroed = static_cast<char *>(umfPoolCalloc(pool, 1, size));
+        ASSERT_NE(zeroed, nullptr);
+        for (size_t i = 0; i < size; i++) {
+            ASSERT_EQ(zeroed[i], 0);
+        }
+        ASSERT_EQ(umfPoolFree(pool, zeroed), UMF_RESULT_SUCCESS);
+    }
+}
+
+TEST_F(test, customBucketSizes) {
+    static const size_t sizes[] = {4200, 520, 1100};
+
+    umf_memory_pool_handle_t pool = NULL;
+    auto config = poolConfig();
+    config.SlabMinSize = 64 * 1024;
+    config.MaxPoolableSize = 64 * 1024;
+    config.BucketSizes = sizes;
+    config.NumBucketSizes = sizeof(sizes) / sizeof(sizes[0]);
+    auto provider = wrapProviderUnique(
+        createProviderChecked(&BA_GLOBAL_PROVIDER_OPS, nullptr));
+    auto ret = umfPoolCreate(umfDisjointPoolOps(), provider.get(),
+                             (void *)&config, 0, &pool);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    auto poolHandle = umf_test::wrapPoolUnique(pool);
+
+    // 1100 is rounded up to a multiple of 8
+    const std::pair<size_t, size_t> expected[] = {
+        {1, 520}, {520, 520}, {521, 1104}, {1100, 1104}, {4000, 4200}};
+    for (auto [size, usableSize] : expected) {
+        void *ptr = umfPoolMalloc(pool, size);
+        ASSERT_NE(ptr, nullptr);
+        EXPECT_EQ(umfPoolMallocUsableSize(pool, ptr), usableSize);
+        ASSERT_EQ(umfPoolFree(pool, ptr), UMF_RESULT_SUCCESS);
+    }
+
+    // sizes above the largest custom bucket use the CutOff bucket,
+    // which has no chunks, so they take whole slabs
+    for (size_t size : {(size_t)5000, (size_t)40 * 1024}) {
+        void *ptr = umfPoolMalloc(pool, size);
+        ASSERT_NE(ptr, nullptr);
+        memset(ptr, 0xab, size);
+        ASSERT_EQ(umfPoolFree(pool, ptr), UMF_RESULT_SUCCESS);
+        void *alignedPtr = umfPoolAlignedMalloc(pool, size, 64);
+        ASSERT_NE(alignedPtr, nullptr);
+        EXPECT_EQ((uintptr_t)alignedPtr % 64, 0);
+        ASSERT_EQ(umfPoolFree(pool, alignedPtr), UMF_RESULT_SUCCESS);
+    }
+
+    // 4200 is not a multiple of 16, so a larger bucket would be used
+    void *ptr = umfPoolAlignedMalloc(pool, 4000, 16);
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ((uintptr_t)ptr % 16, 0);
+    ASSERT_EQ(umfPoolFree(pool, ptr), UMF_RESULT_SUCCESS);
+
+    // custom sizes must not be 0
+    static const size_t invalidSizes[] = {0};
+    config.BucketSizes = invalidSizes;
+    config.NumBucketSizes = 1;
+    umf_memory_pool_handle_t invalidPool = NULL;
+    ret = umfPoolCreate(umfDisjointPoolOps(), provider.get(), (void *)&config,
+                        0, &invalidPool);
+    EXPECT_EQ(ret, UMF_RESULT_ERROR_INVALID_ARGUMENT);
+}
+
+TEST_F(test, decayAndTrim) {
+    static size_t numAllocs = 0;
+    static size_t numFrees = 0;
+
+    struct memory_provider : public umf_test::provider_base_t {
+        umf_result_t alloc(size_t size, size_t, void **ptr) noexcept {
+            *ptr = malloc(size);
+            numAllocs++;
+            return UMF_RESULT_SUCCESS;
+        }
+        umf_result_t free(void *ptr, [[maybe_unused]] size_t size) noexcept {
+            ::free(ptr);
+            numFrees++;
+            return UMF_RESULT_SUCCESS;
+        }
+    };
+    umf_memory_provider_ops_t provider_ops =
+        umf::providerMakeCOps<memory_provider, void>();
+
+    auto provider =
+        wrapProviderUnique(createProviderChecked(&provider_ops, nullptr));
+
+    auto config = poolConfig();
+    config.ReleaseDelayMs = 10;
+
+    umf_memory_pool_handle_t pool = NULL;
+    auto ret = umfPoolCreate(umfDisjointPoolOps(), provider.get(),
+                             (void *)&config, 0, &pool);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    auto poolHandle = umf_test::wrapPoolUnique(pool);
+
+    // allocations of full slabs
+    static constexpr size_t allocSize = 4096;
+    void *ptr1 = umfPoolMalloc(pool, allocSize);
+    void *ptr2 = umfPoolMalloc(pool, allocSize);
+    ASSERT_NE(ptr1, nullptr);
+    ASSERT_NE(ptr2, nullptr);
+    EXPECT_EQ(numAllocs, 2);
+
+    // the slab is kept in the pool
+    ASSERT_EQ(umfPoolFree(pool, ptr1), UMF_RESULT_SUCCESS);
+    EXPECT_EQ(numFrees, 0);
+
+    // the first slab is released once it stayed in the pool long enough
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ASSERT_EQ(umfPoolFree(pool, ptr2), UMF_RESULT_SUCCESS);
+    EXPECT_EQ(numFrees, 1);
+
+    // trim releases the rest
+    EXPECT_EQ(umfDisjointPoolTrim(pool), UMF_RESULT_SUCCESS);
+    EXPECT_EQ(numFrees, 2);
+
+    EXPECT_EQ(umfDisjointPoolTrim(nullptr), UMF_RESULT_ERROR_INVALID_ARGUMENT);
+}
+
+TEST_F(test, getStats) {
+    struct memory_provider : public umf_test::provider_base_t {
+        umf_result_t alloc(size_t size, size_t, void **ptr) noexcept {
+            *ptr = malloc(size);
+            return UMF_RESULT_SUCCESS;
+        }
+        umf_result_t free(void *ptr, [[maybe_unused]] size_t size) noexcept {
+            ::free(ptr);
+            return UMF_RESULT_SUCCESS;
+        }
+    };
+    umf_memory_provider_ops_t provider_ops =
+        umf::providerMakeCOps<memory_provider, void>();
+
+    auto provider =
+        wrapProviderUnique(createProviderChecked(&provider_ops, nullptr));
+
+    auto config = poolConfig();
+    umf_memory_pool_handle_t pool = NULL;
+    auto ret = umfPoolCreate(umfDisjointPoolOps(), provider.get(),
+                             (void *)&config, 0, &pool);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    auto poolHandle = umf_test::wrapPoolUnique(pool);
+
+    // two chunks of the 128 bucket, a full slab and a provider allocation
+    void *ptrs[] = {umfPoolMalloc(pool, 100), umfPoolMalloc(pool, 100),
+                    umfPoolMalloc(pool, 4096), umfPoolMalloc(pool, 8192)};
+    for (auto *ptr : ptrs) {
+        ASSERT_NE(ptr, nullptr);
+    }
+
+    umf_disjoint_pool_stats_t stats;
+    ret = umfDisjointPoolGetStats(pool, &stats, nullptr, nullptr);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    EXPECT_EQ(stats.AllocCount, 4);
+    EXPECT_EQ(stats.FreeCount, 0);
+    EXPECT_EQ(stats.BytesRequested, 100 + 100 + 4096 + 8192);
+    EXPECT_EQ(stats.BytesUsed, 128 + 128 + 4096 + 8192);
+    EXPECT_EQ(stats.ProviderAllocCount, 3);
+    EXPECT_EQ(stats.ProviderFreeCount, 0);
+    EXPECT_EQ(stats.ProviderBytes, 4096 + 4096 + 8192);
+    EXPECT_EQ(stats.PoolBytes, 0);
+
+    for (auto *ptr : ptrs) {
+        ASSERT_EQ(umfPoolFree(pool, ptr), UMF_RESULT_SUCCESS);
+    }
+
+    // both slabs are kept in the pool
+    size_t numBuckets = 0;
+    ret = umfDisjointPoolGetStats(pool, &stats, nullptr, &numBuckets);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    EXPECT_EQ(stats.FreeCount, 4);
+    EXPECT_EQ(stats.ProviderFreeCount, 1);
+    EXPECT_EQ(stats.ProviderBytes, 4096 + 4096);
+    EXPECT_EQ(stats.PoolBytes, 4096 + 4096);
+    ASSERT_GT(numBuckets, 0);
+
+    std::vector<umf_disjoint_pool_bucket_stats_t> bucketStats(numBuckets);
+    ret = umfDisjointPoolGetStats(pool, nullptr, bucketStats.data(),
+                                  &numBuckets);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    ASSERT_EQ(numBuckets, bucketStats.size());
+
+    size_t found = 0;
+    for (auto &bucket : bucketStats) {
+        if (bucket.Size == 128) {
+            found++;
+            EXPECT_EQ(bucket.AllocCount, 2);
+            EXPECT_EQ(bucket.FreeCount, 2);
+            EXPECT_EQ(bucket.BytesRequested, 200);
+            EXPECT_EQ(bucket.SlabsInUse, 0);
+            EXPECT_EQ(bucket.MaxSlabsInUse, 1);
+            EXPECT_EQ(bucket.SlabsInPool, 1);
+        }
+    }
+    EXPECT_EQ(found, 1);
+
+    EXPECT_EQ(umfDisjointPoolGetStats(pool, nullptr, bucketStats.data(),
+                                      nullptr),
+              UMF_RESULT_ERROR_INVALID_ARGUMENT);
+    EXPECT_EQ(umfDisjointPoolGetStats(nullptr, &stats, nullptr, nullptr),
+              UMF_RESULT_ERROR_INVALID_ARGUMENT);
+}
+
+TEST_F(test, crossThreadFree) {
+    struct memory_provider : public umf_test::provider_base_t {
+        umf_result_t alloc(size_t size, size_t, void **ptr) noexcept {
+#ifndef _WIN32
+            // the memory is not accessible by the CPU, like device memory,
+            // so the pool must not write to it
+            *ptr = mmap(NULL, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS,
+                        -1, 0);
+            if (*ptr == MAP_FAILED) {
+                *ptr = NULL;
+                return UMF_RESULT_ERROR_OUT_OF_HOST_MEMORY;
+            }
+#else
+            *ptr = malloc(size);
+#endif
+            return UMF_RESULT_SUCCESS;
+        }
+        umf_result_t free(void *ptr, [[maybe_unused]] size_t size) noexcept {
+#ifndef _WIN32
+            munmap(ptr, size);
+#else
+            ::free(ptr);
+#endif
+            return UMF_RESULT_SUCCESS;
+        }
+    };
+    umf_memory_provider_ops_t provider_ops =
+        umf::providerMakeCOps<memory_provider, void>();
+
+    auto provider =
+        wrapProviderUnique(createProviderChecked(&provider_ops, nullptr));
+
+    auto config = poolConfig();
+    config.SlabMinSize = 64 * 1024;
+    umf_memory_pool_handle_t pool = NULL;
+    auto ret = umfPoolCreate(umfDisjointPoolOps(), provider.get(),
+                             (void *)&config, 0, &pool);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    auto poolHandle = umf_test::wrapPoolUnique(pool);
+
+    // chunks allocated by one thread are freed by the other ones, which
+    // contend on the same bucket
+    static constexpr size_t numThreads = 4;
+    static constexpr size_t numAllocs = 4096;
+    std::vector<void *> ptrs(numAllocs * numThreads);
+    for (auto &ptr : ptrs) {
+        ptr = umfPoolMalloc(pool, 64);
+        ASSERT_NE(ptr, nullptr);
+    }
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < numThreads; t++) {
+        threads.emplace_back([&, t] {
+            for (size_t i = t; i < ptrs.size(); i += numThreads) {
+                EXPECT_EQ(umfPoolFree(pool, ptrs[i]), UMF_RESULT_SUCCESS);
+                if (i % 16 == t) {
+                    umfPoolFree(pool, umfPoolMalloc(pool, 64));
+                }
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    // all slabs are free and released by trim
+    EXPECT_EQ(umfDisjointPoolTrim(pool), UMF_RESULT_SUCCESS);
+    umf_disjoint_pool_stats_t stats;
+    ret = umfDisjointPoolGetStats(pool, &stats, nullptr, nullptr);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    EXPECT_EQ(stats.FreeCount, stats.AllocCount);
+    EXPECT_EQ(stats.ProviderBytes, 0);
+}
+
+TEST_F(test, slabExtents) {
+    static size_t numAllocs = 0;
+    static size_t numFrees = 0;
+
+    struct memory_provider : public umf_test::provider_base_t {
+        umf_result_t alloc(size_t size, size_t, void **ptr) noexcept {
+            *ptr = aligned_alloc(4096, size);
+            numAllocs++;
+            return UMF_RESULT_SUCCESS;
+        }
+        umf_result_t free(void *ptr, [[maybe_unused]] size_t size) noexcept {
+            ::free(ptr);
+            numFrees++;
+            return UMF_RESULT_SUCCESS;
+        }
+    };
+    umf_memory_provider_ops_t provider_ops =
+        umf::providerMakeCOps<memory_provider, void>();
+
+    auto provider =
+        wrapProviderUnique(createProviderChecked(&provider_ops, nullptr));
+
+    auto config = poolConfig();
+    config.SlabExtentSize = 16 * config.SlabMinSize;
+
+    umf_memory_pool_handle_t pool = NULL;
+    auto ret = umfPoolCreate(umfDisjointPoolOps(), provider.get(),
+                             (void *)&config, 0, &pool);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    auto poolHandle = umf_test::wrapPoolUnique(pool);
+
+    // full-slab and chunked allocations share the extents
+    std::vector<void *> ptrs;
+    for (size_t i = 0; i < 24; i++) {
+        ptrs.push_back(umfPoolMalloc(pool, 4096));
+        ASSERT_NE(ptrs.back(), nullptr);
+    }
+    ptrs.push_back(umfPoolMalloc(pool, 64));
+    ASSERT_NE(ptrs.back(), nullptr);
+    EXPECT_EQ(numAllocs, 2);
+
+    for (auto *ptr : ptrs) {
+        EXPECT_EQ(umfPoolByPtr(ptr), pool);
+        memset(ptr, 0xab, umfPoolMallocUsableSize(pool, ptr));
+    }
+
+    for (auto *ptr : ptrs) {
+        ASSERT_EQ(umfPoolFree(pool, ptr), UMF_RESULT_SUCCESS);
+    }
+
+    // pooled slabs keep both extents in use
+    EXPECT_EQ(numFrees, 0);
+
+    EXPECT_EQ(umfDisjointPoolTrim(pool), UMF_RESULT_SUCCESS);
+    EXPECT_EQ(numFrees, 2);
+
+    umf_disjoint_pool_stats_t stats;
+    ret = umfDisjointPoolGetStats(pool, &stats, nullptr, nullptr);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    EXPECT_EQ(stats.ProviderAllocCount, 2);
+    EXPECT_EQ(stats.ProviderFreeCount, 2);
+    EXPECT_EQ(stats.ProviderBytes, 0);
+}
+
+TEST_F(test, callocReusedExtentSlot) {
+    struct memory_provider : public umf_test::provider_base_t {
+        umf_result_t alloc(size_t size, size_t, void **ptr) noexcept {
+            *ptr = aligned_alloc(4096, size);
+            memset(*ptr, 0, size);
+            return UMF_RESULT_SUCCESS;
+        }
+        umf_result_t free(void *ptr, [[maybe_unused]] size_t size) noexcept {
+            ::free(ptr);
+            return UMF_RESULT_SUCCESS;
+        }
+    };
+    umf_memory_provider_ops_t provider_ops =
+        umf::providerMakeCOps<memory_provider, void>();
+
+    auto provider =
+        wrapProviderUnique(createProviderChecked(&provider_ops, nullptr));
+
+    auto config = poolConfig();
+    config.SlabExtentSize = 16 * config.SlabMinSize;
+    config.ProviderMemoryZeroed = 1;
+    config.Capacity = 0; // free slabs are destroyed at once
+
+    umf_memory_pool_handle_t pool = NULL;
+    auto ret = umfPoolCreate(umfDisjointPoolOps(), provider.get(),
+                             (void *)&config, 0, &pool);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    auto poolHandle = umf_test::wrapPoolUnique(pool);
+
+    // a new slab takes the slot of the extent used by the previous one
+    size_t size = config.SlabMinSize;
+    for (int i = 0; i < 2; i++) {
+        auto *ptr = static_cast<char *>(umfPoolCalloc(pool, 1, size));
+        ASSERT_NE(ptr, nullptr);
+        for (size_t j = 0; j < size; j++) {
+            ASSERT_EQ(ptr[j], 0);
+        }
+        memset(ptr, 0xFF, size);
+        ASSERT_EQ(umfPoolFree(pool, ptr), UMF_RESULT_SUCCESS);
+    }
+}
+
+TEST_F(test, largeAlignment) {
+    struct memory_provider : public umf_test::provider_base_t {
+        umf_result_t alloc(size_t size, size_t alignment,
+                           void **ptr) noexcept {
+            *ptr = aligned_alloc(std::max(alignment, (size_t)4096), size);
+            return UMF_RESULT_SUCCESS;
+        }
+        umf_result_t free(void *ptr, [[maybe_unused]] size_t size) noexcept {
+            ::free(ptr);
+            return UMF_RESULT_SUCCESS;
+        }
+        umf_result_t get_min_page_size(void *, size_t *pageSize) noexcept {
+            *pageSize = 4096;
+            return UMF_RESULT_SUCCESS;
+        }
+    };
+    umf_memory_provider_ops_t provider_ops =
+        umf::providerMakeCOps<memory_provider, void>();
+
+    auto provider =
+        wrapProviderUnique(createProviderChecked(&provider_ops, nullptr));
+
+    auto config = poolConfig();
+    config.SlabMinSize = 64 * 1024;
+    config.MaxPoolableSize = 1024 * 1024;
+
+    umf_memory_pool_handle_t pool = NULL;
+    auto ret = umfPoolCreate(umfDisjointPoolOps(), provider.get(),
+                             (void *)&config, 0, &pool);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    auto poolHandle = umf_test::wrapPoolUnique(pool);
+
+    // full slabs and chunks aligned beyond the page size take no more
+    // memory than the aligned size
+    std::vector<void *> ptrs;
+    for (size_t alignment : {64 * 1024, 16 * 1024}) {
+        for (size_t i = 0; i < 4; i++) {
+            void *ptr = umfPoolAlignedMalloc(pool, alignment, alignment);
+            ASSERT_NE(ptr, nullptr);
+            EXPECT_EQ((uintptr_t)ptr % alignment, 0);
+            memset(ptr, 0xab, alignment);
+            ptrs.push_back(ptr);
+        }
+    }
+
+    umf_disjoint_pool_stats_t stats;
+    ret = umfDisjointPoolGetStats(pool, &stats, nullptr, nullptr);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    EXPECT_EQ(stats.ProviderBytes, 5 * config.SlabMinSize);
+    EXPECT_EQ(stats.BytesUsed, 4 * 64 * 1024 + 4 * 16 * 1024);
+
+    for (auto *ptr : ptrs) {
+        ASSERT_EQ(umfPoolFree(pool, ptr), UMF_RESULT_SUCCESS);
+    }
+    EXPECT_EQ(umfDisjointPoolTrim(pool), UMF_RESULT_SUCCESS);
+    ret = umfDisjointPoolGetStats(pool, &stats, nullptr, nullptr);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    EXPECT_EQ(stats.ProviderBytes, 0);
+}
+
+TEST_F(test, largeAllocationCache) {
+    static size_t numAllocs = 0;
+    static size_t numFrees = 0;
+
+    struct memory_provider : public umf_test::provider_base_t {
+        umf_result_t alloc(size_t size, size_t, void **ptr) noexcept {
+            *ptr = malloc(size);
+            numAllocs++;
+            return UMF_RESULT_SUCCESS;
+        }
+        umf_result_t free(void *ptr, [[maybe_unused]] size_t size) noexcept {
+            ::free(ptr);
+            numFrees++;
+            return UMF_RESULT_SUCCESS;
+        }
+    };
+    umf_memory_provider_ops_t provider_ops =
+        umf::providerMakeCOps<memory_provider, void>();
+
+    auto provider =
+        wrapProviderUnique(createProviderChecked(&provider_ops, nullptr));
+
+    static constexpr size_t MB = 1024 * 1024;
+    auto config = poolConfig();
+    config.LargeCacheSize = 2 * MB;
+
+    umf_memory_pool_handle_t pool = NULL;
+    auto ret = umfPoolCreate(umfDisjointPoolOps(), provider.get(),
+                             (void *)&config, 0, &pool);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    auto poolHandle = umf_test::wrapPoolUnique(pool);
+
+    void *ptr1 = umfPoolMalloc(pool, MB);
+    ASSERT_NE(ptr1, nullptr);
+    ASSERT_EQ(umfPoolFree(pool, ptr1), UMF_RESULT_SUCCESS);
+    EXPECT_EQ(numFrees, 0);
+
+    umf_disjoint_pool_stats_t stats;
+    ret = umfDisjointPoolGetStats(pool, &stats, nullptr, nullptr);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    EXPECT_EQ(stats.PoolBytes, MB);
+
+    // a slightly smaller request reuses the cached allocation
+    void *ptr2 = umfPoolMalloc(pool, MB - MB / 16);
+    EXPECT_EQ(ptr2, ptr1);
+    EXPECT_EQ(umfPoolMallocUsableSize(pool, ptr2), MB);
+    EXPECT_EQ(numAllocs, 1);
+
+    // but a much smaller one does not
+    ASSERT_EQ(umfPoolFree(pool, ptr2), UMF_RESULT_SUCCESS);
+    void *ptr3 = umfPoolMalloc(pool, MB / 2);
+    ASSERT_NE(ptr3, nullptr);
+    EXPECT_EQ(numAllocs, 2);
+
+    // the least recently freed allocation is released to stay within
+    // the cache size
+    void *ptr4 = umfPoolMalloc(pool, MB + MB / 2);
+    ASSERT_NE(ptr4, nullptr);
+    ASSERT_EQ(umfPoolFree(pool, ptr3), UMF_RESULT_SUCCESS);
+    EXPECT_EQ(numFrees, 0);
+    ASSERT_EQ(umfPoolFree(pool, ptr4), UMF_RESULT_SUCCESS);
+    EXPECT_EQ(numFrees, 1);
+
+    EXPECT_EQ(umfDisjointPoolTrim(pool), UMF_RESULT_SUCCESS);
+    EXPECT_EQ(numFrees, 3);
+    ret = umfDisjointPoolGetStats(pool, &stats, nullptr, nullptr);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    EXPECT_EQ(stats.PoolBytes, 0);
+    EXPECT_EQ(stats.ProviderBytes, 0);
+}
+
 auto defaultPoolConfig = poolConfig();
+
+umf_disjoint_pool_params_t threadCachePoolConfig() {
+    umf_disjoint_pool_params_t config = poolConfig();
+    config.ThreadCacheSize = 8;
+    return config;
+}
+
+auto threadCacheConfig = threadCachePoolConfig();
+INSTANTIATE_TEST_SUITE_P(disjointPoolThreadCacheTests, umfPoolTest,
+                         ::testing::Values(poolCreateExtParams{
+                             umfDisjointPoolOps(), (void *)&threadCacheConfig,
+                             &BA_GLOBAL_PROVIDER_OPS, nullptr, nullptr}));
+
+INSTANTIATE_TEST_SUITE_P(disjointMultiPoolThreadCacheTests, umfMultiPoolTest,
+                         ::testing::Values(poolCreateExtParams{
+                             umfDisjointPoolOps(), (void *)&threadCacheConfig,
+                             &BA_GLOBAL_PROVIDER_OPS, nullptr, nullptr}));
+
+umf_disjoint_pool_params_t shardedPoolConfig() {
+    umf_disjoint_pool_params_t config = poolConfig();
+    config.NumShards = 4;
+    config.ShardByCpu = 1;
+    return config;
+}
+
+auto shardedConfig = shardedPoolConfig();
+INSTANTIATE_TEST_SUITE_P(disjointPoolShardedTests, umfPoolTest,
+                         ::testing::Values(poolCreateExtParams{
+                             umfDisjointPoolOps(), (void *)&shardedConfig,
+                             &BA_GLOBAL_PROVIDER_OPS, nullptr, nullptr}));
+
+INSTANTIATE_TEST_SUITE_P(disjointMultiPoolShardedTests, umfMultiPoolTest,
+                         ::testing::Values(poolCreateExtParams{
+                             umfDisjointPoolOps(), (void *)&shardedConfig,
+                             &BA_GLOBAL_PROVIDER_OPS, nullptr, nullptr}));
+
+umf_disjoint_pool_params_t fineClassesPoolConfig() {
+    umf_disjoint_pool_params_t config = poolConfig();
+    config.ClassesPerPowerOf2 = 4;
+    return config;
+}
+
+auto fineClassesConfig = fineClassesPoolConfig();
+INSTANTIATE_TEST_SUITE_P(disjointPoolFineClassesTests, umfPoolTest,
+                         ::testing::Values(poolCreateExtParams{
+                             umfDisjointPoolOps(), (void *)&fineClassesConfig,
+                             &BA_GLOBAL_PROVIDER_OPS, nullptr, nullptr}));
+
+umf_disjoint_pool_params_t extentsPoolConfig() {
+    umf_disjoint_pool_params_t config = poolConfig();
+    config.SlabExtentSize = 64 * config.SlabMinSize;
+    return config;
+}
+
+auto extentsConfig = extentsPoolConfig();
+INSTANTIATE_TEST_SUITE_P(disjointPoolExtentsTests, umfPoolTest,
+                         ::testing::Values(poolCreateExtParams{
+                             umfDisjointPoolOps(), (void *)&extentsConfig,
+                             &BA_GLOBAL_PROVIDER_OPS, nullptr, nullptr}));
+
 INSTANTIATE_TEST_SUITE_P(disjointPoolTests, umfPoolTest,
                          ::testing::Values(poolCreateExtParams{
                              umfDisjointPoolOps(), (void *)&defaultPoolConfig,
@@ -372,6 +372,13 @@ umf_os_memory_provider_params_t osMemoryProviderParamsShared() {
 }
 auto os_params = osMemoryProviderParamsShared();
 
+umf_os_memory_provider_params_t osMemoryProviderParamsMapSegments() {
+    auto params = osMemoryProviderParamsShared();
+    params.ipc_map_segments = true;
+    return params;
+}
+auto os_params_map_segments = osMemoryProviderParamsMapSegments();
+
 HostMemoryAccessor hostAccessor;
 
 umf_disjoint_pool_params_t disjointPoolParams() {
@@ -388,8 +395,145 @@ static std::vector<ipcTestParams> ipcTestParamsList = {
 #if (defined UMF_POOL_DISJOINT_ENABLED)
     {umfDisjointPoolOps(), &disjointParams, umfOsMemoryProviderOps(),
      &os_params, &hostAccessor, false},
+    {umfDisjointPoolOps(), &disjointParams, umfOsMemoryProviderOps(),
+     &os_params_map_segments, &hostAccessor, false},
 #endif
 };
 
 INSTANTIATE_TEST_SUITE_P(osProviderTest, umfIpcTest,
                          ::testing::ValuesIn(ipcTestParamsList));
+
+// pool passing allocations directly to the OS provider
+static umf::pool_unique_handle_t
+osProxyPool(umf_os_memory_provider_params_t *params) {
+    umf_memory_provider_handle_t hProvider = nullptr;
+    umf_memory_pool_handle_t hPool = nullptr;
+
+    auto ret =
+        umfMemoryProviderCreate(umfOsMemoryProviderOps(), params, &hProvider);
+    EXPECT_EQ(ret, UMF_RESULT_SUCCESS);
+
+    ret = umfPoolCreate(umfProxyPoolOps(), hProvider, nullptr,
+                        UMF_POOL_CREATE_FLAG_OWN_PROVIDER, &hPool);
+    EXPECT_EQ(ret, UMF_RESULT_SUCCESS);
+
+    return umf::pool_unique_handle_t(hPool, &umfPoolDestroy);
+}
+
+TEST_F(test, ipcMapSegmentsGrowWindow) {
+    auto producer = osProxyPool(&os_params);
+    auto consumer = osProxyPool(&os_params_map_segments);
+
+    // the second allocation lies beyond the window mapped for the first one
+    constexpr size_t N = 2;
+    const size_t sizes[N] = {4096, 4 * 1024 * 1024};
+    char *ptrs[N];
+    umf_ipc_handle_t handles[N];
+    char *opened[N];
+    for (size_t i = 0; i < N; i++) {
+        ptrs[i] = static_cast<char *>(umfPoolMalloc(producer.get(), sizes[i]));
+        ASSERT_NE(ptrs[i], nullptr);
+        memset(ptrs[i], 'a' + (int)i, sizes[i]);
+
+        size_t handleSize = 0;
+        auto ret = umfGetIPCHandle(ptrs[i], &handles[i], &handleSize);
+        ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+        ret = umfOpenIPCHandle(consumer.get(), handles[i], (void **)&opened[i]);
+        ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    }
+
+    // the mapping of the first handle stays valid after the window grew
+    for (size_t i = 0; i < N; i++) {
+        EXPECT_EQ(opened[i][0], 'a' + (int)i);
+        EXPECT_EQ(opened[i][sizes[i] - 1], 'a' + (int)i);
+    }
+    ptrs[0][1] = 'z';
+    EXPECT_EQ(opened[0][1], 'z');
+
+    for (size_t i = 0; i < N; i++) {
+        EXPECT_EQ(umfCloseIPCHandle(opened[i]), UMF_RESULT_SUCCESS);
+        EXPECT_EQ(umfPutIPCHandle(handles[i]), UMF_RESULT_SUCCESS);
+        EXPECT_EQ(umfPoolFree(producer.get(), ptrs[i]), UMF_RESULT_SUCCESS);
+    }
+}
+
+TEST_F(test, ipcMapSegmentsReexportedHandle) {
+    auto producer = osProxyPool(&os_params);
+    auto consumer = osProxyPool(&os_params_map_segments);
+
+    // only one allocation is kept in the cache of exported handles, so
+    // exporting another allocation makes the next handle of ptr a new one
+    auto ret = umfPoolSetIPCCacheCapacity(producer.get(),
+                                          UMF_IPC_CACHE_EXPORTED, 1);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+
+    constexpr size_t SIZE = 4096;
+    char *ptr = static_cast<char *>(umfPoolMalloc(producer.get(), SIZE));
+    ASSERT_NE(ptr, nullptr);
+    void *other = umfPoolMalloc(producer.get(), SIZE);
+    ASSERT_NE(other, nullptr);
+
+    auto exportAgain = [&](umf_ipc_handle_t *handle) {
+        umf_ipc_handle_t otherHandle = nullptr;
+        size_t handleSize = 0;
+        ASSERT_EQ(umfGetIPCHandle(other, &otherHandle, &handleSize),
+                  UMF_RESULT_SUCCESS);
+        ASSERT_EQ(umfPutIPCHandle(otherHandle), UMF_RESULT_SUCCESS);
+        ASSERT_EQ(umfGetIPCHandle(ptr, handle, &handleSize),
+                  UMF_RESULT_SUCCESS);
+    };
+
+    umf_ipc_handle_t handle1 = nullptr;
+    size_t handleSize = 0;
+    ret = umfGetIPCHandle(ptr, &handle1, &handleSize);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    char *opened1 = nullptr;
+    ret = umfOpenIPCHandle(consumer.get(), handle1, (void **)&opened1);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    // the unused mapping stays cached in the consumer
+    ret = umfCloseIPCHandle(opened1);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+
+    // the new handle is opened at the same address in the segment
+    umf_ipc_handle_t handle2 = nullptr;
+    exportAgain(&handle2);
+    char *opened2 = nullptr;
+    ret = umfOpenIPCHandle(consumer.get(), handle2, (void **)&opened2);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    EXPECT_EQ(opened2, opened1);
+    ptr[0] = 'a';
+    EXPECT_EQ(opened2[0], 'a');
+
+    // the mapping can be shared with a handle which is still open
+    umf_ipc_handle_t handle3 = nullptr;
+    exportAgain(&handle3);
+    char *opened3 = nullptr;
+    ret = umfOpenIPCHandle(consumer.get(), handle3, (void **)&opened3);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    EXPECT_EQ(opened3, opened2);
+
+    // the shared mapping is cached under the key of the new handle
+    umf_ipc_cache_stats_t stats;
+    ret = umfPoolGetIPCCacheStats(consumer.get(), UMF_IPC_CACHE_OPENED, &stats);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    size_t hits = stats.hits;
+    char *opened3Again = nullptr;
+    ret = umfOpenIPCHandle(consumer.get(), handle3, (void **)&opened3Again);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    EXPECT_EQ(opened3Again, opened3);
+    ret = umfPoolGetIPCCacheStats(consumer.get(), UMF_IPC_CACHE_OPENED, &stats);
+    ASSERT_EQ(ret, UMF_RESULT_SUCCESS);
+    EXPECT_EQ(stats.hits, hits + 1);
+    EXPECT_EQ(stats.size, 1);
+
+    EXPECT_EQ(umfCloseIPCHandle(opened3Again), UMF_RESULT_SUCCESS);
+    EXPECT_EQ(umfCloseIPCHandle(opened3), UMF_RESULT_SUCCESS);
+    EXPECT_EQ(umfCloseIPCHandle(opened2), UMF_RESULT_SUCCESS);
+    EXPECT_EQ(umfCloseIPCHandle(opened2), UMF_RESULT_ERROR_INVALID_ARGUMENT);
+
+    for (auto handle : {handle1, handle2, handle3}) {
+        EXPECT_EQ(umfPutIPCHandle(handle), UMF_RESULT_SUCCESS);
+    }
+    EXPECT_EQ(umfPoolFree(producer.get(), other), UMF_RESULT_SUCCESS);
+    EXPECT_EQ(umfPoolFree(producer.get(), ptr), UMF_RESULT_SUCCESS);
+}